@@ -3,103 +3,1553 @@
  * Rothlauf's "Representations for Genetic and Evolutionary Algorithms", 2nd ed.,
  * p. 77, eq. 3.23.
  * A bit-to-integer representation is given as a permutation of all the values in
- * the range [0:2^N).
+ * the range [0:2^N), for any N up to MAX_BITS, read from a file (run without
+ * arguments for the options and a few sample 3-bit representations).
+ * It can also search for representations with the lowest or highest locality,
+ * distance distortion or number of local optima, and reduce representations
+ * to a canonical form under the symmetries of the hypercube, to cache their
+ * metrics once for all equivalent representations.
+ * Finally, it enumerates Gray codes, as Hamiltonian paths on the hypercube.
+ * Prerequisite: Intel TBB library (libtbb-dev on debian distributions).
+ *
+ * Compile with:
+   g++ -Wall -Wextra -pedantic -O3 -march=native -std=c++17 locality.cc -ltbb -o locality
  *
  * author: Eitan Frachtenberg
  */
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/blocked_range.h"
+#include "tbb/spin_mutex.h"
+using namespace tbb;
 
 // In this implementation, all bit strings are represented as a simple
-// integer (with the typical binary representation), up to 256 bits.
-using bits_t = uint8_t;
-using num_t = uint64_t;  // A natural number, what we're representing.
+// integer (with the typical binary representation), up to 32 bits.
+using bits_t = uint32_t;
+using num_t = uint32_t;  // A natural number, what we're representing.
+
+constexpr unsigned MAX_BITS = 30;   // How many bits long can a representation be?
+
+// The binary mapping library format of onemax.cc (see mapping_library_t
+// there): a header of this magic string, the width and the number of
+// mappings as native 32-bit values, and then the mappings, each of 2^width
+// entries of the narrowest unsigned type that holds a value.
+constexpr char LIBRARY_MAGIC[8] = { 'R', 'E', 'P', 'L', 'I', 'B', '0', '1' };
+constexpr size_t LIBRARY_HEADER = sizeof(LIBRARY_MAGIC) + 2 * sizeof(uint32_t);
+size_t library_entry_size(unsigned bits) { return bits <= 8? 1 : bits <= 16? 2 : 4; }
 
-constexpr bits_t BITS = 3;   // How many bits long is the representation?
-constexpr num_t N = 1ULL << BITS;   // No. of distinct values in representation.
+// Defaults of the search for representations:
+constexpr unsigned EXHAUSTIVE_BITS = 3;          // Exhaustive up to this width
+constexpr unsigned RESTARTS = 64;                // Simulated annealing restarts
+constexpr uint64_t ITERATIONS_PER_VALUE = 1000;  // And swaps per restart
 
 // A representation is simply a mapping from bit string to an integer value
-// in the range 0..N-1. There are N such values, so we map each bit string
-// (in the normal binary enumeration order) to a value.
-using rep_t = std::array<num_t, N>;
+// in the range 0..N-1, N = 2^bits(). There are N such values, so we map each
+// bit string (in the normal binary enumeration order) to a value. The values
+// are either owned by the representation, or a read-only memory map of a
+// binary file: either native 32-bit values, or a mapping library, of which
+// the first mapping is used (in place if its entries are 32-bit).
+class rep_t {
+ public:
+  rep_t(std::initializer_list<num_t> values)
+  : rep_t(std::vector<num_t>(values))
+  {}
 
-// A list of all neighbors (single-bit mutations) for a given bitstring
-using neighbors_t = std::array<bits_t, BITS>;
+  explicit rep_t(std::vector<num_t> values)
+  : owned_(std::move(values)), map_(nullptr), map_size_(0)
+  , data_(owned_.data()), size_(owned_.size()), bits_(width(size_))
+  {}
+
+  // Map a binary file of native 32-bit values, or a mapping library:
+  explicit rep_t(const std::string& fname)
+  : owned_(), map_(nullptr), map_size_(0), data_(nullptr), size_(0), bits_(0)
+  {
+    const int fd = open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      std::cerr << "Can't read " << fname << "\n";
+      exit(1);
+    }
+    map_size_ = st.st_size;
+    if (map_size_ > 0) {
+      map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map_ == MAP_FAILED || map_ == nullptr) {
+      std::cerr << "Can't map " << fname << "\n";
+      exit(1);
+    }
+    madvise(map_, map_size_, MADV_WILLNEED);
+    data_ = static_cast<const num_t*>(map_);
+    size_ = map_size_ / sizeof(num_t);
+
+    const char* data = static_cast<const char*>(map_);
+    if (map_size_ >= LIBRARY_HEADER && !memcmp(data, LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC))) {
+      uint32_t fields[2];
+      memcpy(fields, data + sizeof(LIBRARY_MAGIC), sizeof(fields));
+      const size_t entry = library_entry_size(fields[0]);
+      if (fields[0] > MAX_BITS || fields[1] == 0
+          || map_size_ < LIBRARY_HEADER + (entry << fields[0])) {
+        std::cerr << fname << " has no mapping of up to " << MAX_BITS << " bits\n";
+        exit(1);
+      }
+      size_ = uint64_t(1) << fields[0];
+      data += LIBRARY_HEADER;
+      if (entry == sizeof(num_t)) {
+        data_ = reinterpret_cast<const num_t*>(data);
+      } else {
+        owned_.resize(size_);
+        for (uint64_t i = 0; i < size_; ++i) {
+          memcpy(&owned_[i], data + i * entry, entry);  // Little endian
+        }
+        data_ = owned_.data();
+      }
+    }
+    bits_ = width(size_);
+  }
+
+  rep_t(const rep_t&) = delete;
+  rep_t& operator=(const rep_t&) = delete;
+
+  ~rep_t()
+  {
+    if (map_) {
+      munmap(map_, map_size_);
+    }
+  }
+
+  unsigned bits() const { return bits_; }
+  uint64_t size() const { return size_; }
+  const num_t* data() const { return data_; }
+  num_t operator[](bits_t bits) const { return data_[bits]; }
+
+ private:
+  // log2(size), or 0 if size isn't a power of two of at most MAX_BITS bits:
+  static unsigned width(uint64_t size)
+  {
+    unsigned ret = 0;
+    while ((uint64_t(1) << ret) < size) {
+      ++ret;
+    }
+    return (uint64_t(1) << ret) == size && ret <= MAX_BITS? ret : 0;
+  }
+
+  std::vector<num_t> owned_;
+  void* map_;
+  size_t map_size_;
+  const num_t* data_;
+  uint64_t size_;
+  unsigned bits_;
+};
 
 
 //////////////////////
 // Utility functions
 
+// Read the values of a representation from a text file (or stream) of
+// whitespace-separated decimal numbers, on one line or many. As in the text
+// mapping libraries of onemax.cc, lines that start with '#' are comments,
+// and anything up to a colon on a line is a name, not values.
+std::vector<num_t>
+read_text(FILE* in)
+{
+  std::vector<num_t> values;
+  std::vector<char> buf(1 << 20);
+  uint64_t value = 0;
+  bool in_number = false, line_start = true, comment = false;
+  size_t line_first = 0;  // Where the values of this line start
+  for (size_t n; (n = fread(buf.data(), 1, buf.size(), in)) > 0; ) {
+    for (size_t i = 0; i < n; ++i) {
+      const char c = buf[i];
+      if (c == '\n') {
+        comment = false;
+        line_start = true;
+      } else if (comment || (line_start && (c == ' ' || c == '\t'))) {
+        continue;
+      } else if (line_start && c == '#') {
+        comment = true;
+        continue;
+      } else {
+        line_start = false;
+      }
+
+      if (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        in_number = true;
+        continue;
+      } else if (in_number) {
+        values.push_back(value);
+        value = 0;
+        in_number = false;
+      }
+      if (c == ':') {
+        values.resize(line_first);
+      } else if (c == '\n') {
+        line_first = values.size();
+      }
+    }
+  }
+  if (in_number) {
+    values.push_back(value);
+  }
+  return values;
+}
 
 // Check whether a set of values is actually a representation, namely,
 // a permutation of the values 0..N-1.
 bool
 is_representation(const rep_t& rep)
 {
-  rep_t reference;
-  std::iota(reference.begin(), reference.end(), 0);
-  return std::is_permutation(rep.begin(), rep.end(), reference.begin());
+  if (rep.bits() == 0 && rep.size() != 1) {
+    return false;
+  }
+  std::vector<bool> seen(rep.size(), false);
+  for (uint64_t i = 0; i < rep.size(); ++i) {
+    if (rep[i] >= rep.size() || seen[rep[i]]) {
+      return false;
+    }
+    seen[rep[i]] = true;
+  }
+  return true;
 }
 
-// Return an array of all the bit strings that are single-bit neighbors
-// of a given bit string.
-neighbors_t
-bit_neighbors(bits_t bits)
+// The sum of |a[j] - b[j]| over n pairs of values, in a form the compiler
+// vectorizes.
+inline uint64_t
+distance_sum(const num_t* __restrict a, const num_t* __restrict b, size_t n)
 {
-  neighbors_t ret;
-  for (bits_t i = 0; i < BITS; i++) {
-    ret[i] = bits ^ (1 << i);
+  uint64_t sum = 0;
+  for (size_t j = 0; j < n; ++j) {
+    sum += std::llabs(int64_t(a[j]) - int64_t(b[j]));
   }
-  return ret;
+  return sum;
 }
 
+// The locality of a representation, and its single-bit breakdown: by_bit[i]
+// sums up only the neighbors that differ in bit i.
+struct locality_t {
+  uint64_t total = 0;
+  std::array<uint64_t, MAX_BITS> by_bit {};
+};
 
 // Main utility function: for a given representation, compute its locality.
-uint64_t
+// The neighbors of a bit string x are x ^ (1 << i), so rather than listing
+// them, the bit strings are swept in blocks of 2^BLOCK_BITS: neighbors across
+// a low bit are in the same block, at a fixed distance, and neighbors across
+// a high bit are in a partner block, at the same offset. Either way, the
+// phenotype distances are between two contiguous runs of values.
+locality_t
 locality(const rep_t& rep)
 {
   assert(is_representation(rep));
+  constexpr unsigned BLOCK_BITS = 12;
+  using sums_t = std::array<uint64_t, MAX_BITS>;
+
+  const unsigned bits = rep.bits();
+  const unsigned block_bits = std::min(bits, BLOCK_BITS);
+  const uint64_t block = uint64_t(1) << block_bits;
+  const num_t* p = rep.data();
+
+  // Sum up the phenotype distances between all neighbors, each pair once:
+  const auto sums = parallel_reduce(
+      blocked_range<uint64_t>(0, rep.size() >> block_bits), sums_t {},
+      [&](const blocked_range<uint64_t>& r, sums_t sums) {
+        for (auto b = r.begin(); b != r.end(); ++b) {
+          const auto x = b << block_bits;
+          for (unsigned i = 0; i < block_bits; ++i) {
+            const uint64_t m = uint64_t(1) << i;
+            for (auto y = x; y < x + block; y += 2 * m) {
+              sums[i] += distance_sum(p + y, p + y + m, m);
+            }
+          }
+          for (unsigned i = block_bits; i < bits; ++i) {
+            if (!((x >> i) & 1)) {
+              sums[i] += distance_sum(p + x, p + (x | (uint64_t(1) << i)), block);
+            }
+          }
+        }
+        return sums;
+      },
+      [](sums_t a, const sums_t& b) {
+        for (unsigned i = 0; i < MAX_BITS; ++i) {
+          a[i] += b[i];
+        }
+        return a;
+      });
 
-  // Compute a mapping from any bitstring to its neighbors:
-  std::array<neighbors_t, N> n_map;
-  for (num_t i = 0; i < N; ++i) {
-    n_map[i] = bit_neighbors(i);
+  // Each of the N/2 pairs per bit adds its distance less the minimal
+  // distance, 1. We only summed up half the cases, because of symmetry, so
+  // the total sum must be doubled.
+  locality_t ret;
+  for (unsigned i = 0; i < bits; ++i) {
+    ret.by_bit[i] = (sums[i] - rep.size() / 2) * 2;
+    ret.total += ret.by_bit[i];
   }
+  return ret;
+}
 
-  // Now, we can sum up the integer value differences between all neighbors
-  uint64_t sum = 0;
+// The distance distortion of a representation, as defined in Rothlauf's book,
+// p. 84, with Hamming distance between genotypes and absolute difference
+// between phenotypes: the mean over all pairs of bit strings of
+// |d_p - d_g|, and the same mean of d_p - d_g, without the absolute value
+// (as distdistortion.py's computeDistanceDistortionTriangle() does).
+struct distortion_t {
+  double distortion;
+  double triangle;
+};
+
+// The sums over all pairs of bit strings behind both distance distortions,
+// exactly. They grow as about N^3 / 6, past 64 bits from 22 bits on, so
+// they're 128-bit.
+__extension__ typedef __int128 int128_t;
+struct distortion_sums_t {
+  int128_t distortion = 0, triangle = 0;
+};
+
+// Both sums, in one pass over all pairs of bit strings, by tiles of
+// BLOCK x BLOCK pairs, so that the values of a tile are in cache, and each
+// tile is a vectorized loop of popcounts and differences (whose sums fit in
+// 64 bits).
+distortion_sums_t
+distortion_sums(const rep_t& rep)
+{
+  assert(is_representation(rep));
+  constexpr uint64_t BLOCK = 2048;
+  using sums_t = distortion_sums_t;
+
+  const uint64_t n = rep.size(), nblocks = (n + BLOCK - 1) / BLOCK;
+  const num_t* p = rep.data();
+
+  return parallel_reduce(
+      blocked_range<uint64_t>(0, nblocks, 1), sums_t {},
+      [&](const blocked_range<uint64_t>& r, sums_t sums) {
+        for (auto bi = r.begin(); bi != r.end(); ++bi) {
+          const auto i0 = bi * BLOCK, i1 = std::min(i0 + BLOCK, n);
+          for (auto j0 = i0; j0 < n; j0 += BLOCK) {
+            const auto j1 = std::min(j0 + BLOCK, n);
+            for (auto i = i0; i < i1; ++i) {
+              const int64_t pi = p[i];
+              int64_t distortion = 0, triangle = 0;
+              for (auto j = std::max(j0, i + 1); j < j1; ++j) {
+                const int64_t d = std::llabs(pi - p[j]) - __builtin_popcount(bits_t(i ^ j));
+                distortion += std::llabs(d);
+                triangle += d;
+              }
+              sums.distortion += distortion;
+              sums.triangle += triangle;
+            }
+          }
+        }
+        return sums;
+      },
+      [](sums_t a, const sums_t& b) {
+        a.distortion += b.distortion;
+        a.triangle += b.triangle;
+        return a;
+      });
+}
+
+// Both distance distortions, as the means of those sums:
+distortion_t
+distance_distortion(const rep_t& rep)
+{
+  const auto sums = distortion_sums(rep);
+  const double pairs = double(rep.size()) * (rep.size() - 1) / 2;
+  return { double(sums.distortion) / pairs, double(sums.triangle) / pairs };
+}
+
+// Nearest values of neighbors: for each of n bit strings of values v, whose
+// neighbors across some bit have values w, update the nearest neighbor
+// value above, and the nearest below plus one (0 for none), in a form the
+// compiler vectorizes.
+inline void
+nearest_values(const num_t* __restrict v, const num_t* __restrict w, size_t n,
+               num_t* __restrict below, num_t* __restrict above)
+{
+  for (size_t j = 0; j < n; ++j) {
+    below[j] = w[j] < v[j]? std::max(below[j], w[j] + 1) : below[j];
+    above[j] = w[j] > v[j]? std::min(above[j], w[j]) : above[j];
+  }
+}
+
+// The number of local optima of the one-max fitness, f(x) = N - 1 - |x - a|
+// as in onemax.cc, for every target value a: the bit strings none of whose
+// neighbors are fitter (as countOptimaBitstring() in representation.py
+// counts them, including the global optimum). For a bit string of value v,
+// a neighbor of value w > v is no fitter for a <= (v + w) / 2, and one of
+// value w < v for a >= (v + w) / 2, so the bit string is an optimum for an
+// interval of a, which only depends on its nearest neighbor values above and
+// below v. Those are found by the same sweep over blocks of bit strings as
+// in locality(), and the counts for all a are then the prefix sums of a
+// difference array of the intervals.
+std::vector<uint64_t>
+optima_census(const rep_t& rep)
+{
+  assert(is_representation(rep));
+  constexpr unsigned BLOCK_BITS = 11;
 
-  for (num_t i = 0; i < N; ++i) { // Loop over all bit strings
-    const auto phenotype1 = rep[i];
-    for (bits_t n = 0; n < BITS; ++n) { // Loop over all neighbors of string
-      const auto phenotype2 = rep[n_map[i][n]];
-      if (phenotype1 > phenotype2) {
-        sum += phenotype1 - phenotype2 - 1;
+  const unsigned bits = rep.bits();
+  const unsigned block_bits = std::min(bits, BLOCK_BITS);
+  const uint64_t n = rep.size(), block = uint64_t(1) << block_bits;
+  const num_t* p = rep.data();
+  std::vector<num_t> lo(n), hi(n);  // The interval of each bit string
+
+  parallel_for(blocked_range<uint64_t>(0, n >> block_bits), [&](const blocked_range<uint64_t>& r) {
+    std::array<num_t, 1u << BLOCK_BITS> below, above;
+    for (auto b = r.begin(); b != r.end(); ++b) {
+      const auto x = b << block_bits;
+      std::fill(below.begin(), below.end(), 0);
+      std::fill(above.begin(), above.end(), n);
+      for (unsigned i = 0; i < block_bits; ++i) {
+        const uint64_t m = uint64_t(1) << i;
+        for (uint64_t y = 0; y < block; y += 2 * m) {
+          nearest_values(p + x + y, p + x + y + m, m, &below[y], &above[y]);
+          nearest_values(p + x + y + m, p + x + y, m, &below[y + m], &above[y + m]);
+        }
+      }
+      for (unsigned i = block_bits; i < bits; ++i) {
+        nearest_values(p + x, p + (x ^ (uint64_t(1) << i)), block, below.data(), above.data());
+      }
+      for (uint64_t j = 0; j < block; ++j) {
+        const uint64_t v = p[x + j];
+        lo[x + j] = below[j]? (v + below[j]) / 2 : 0;
+        hi[x + j] = above[j] < n? (v + above[j]) / 2 : n - 1;
       }
     }
+  });
+
+  std::vector<int64_t> diff(n + 1, 0);
+  for (uint64_t x = 0; x < n; ++x) {
+    ++diff[lo[x]];
+    --diff[hi[x] + 1];
   }
-  // We only sum up half the cases, because of symmetry, so the total
-  // sum must be doubled.
-  return sum * 2;
+  std::vector<uint64_t> ret(n);
+  int64_t count = 0;
+  for (uint64_t a = 0; a < n; ++a) {
+    count += diff[a];
+    ret[a] = count;
+  }
+  return ret;
 }
 
-int main()
+// What a search over representations optimizes, as an integral score:
+// the locality; the distance distortion, as the sum over all pairs of bit
+// strings of |d_p - d_g| (see distortion_sums()); or the number of local
+// optima of the one-max fitness, summed over all targets a (see
+// optima_census()).
+enum class objective_t { LOCALITY, DISTORTION, OPTIMA };
+
+// A representation that changes by swapping the values of two bit strings,
+// keeping track of its score as it goes. A swap only changes the distances
+// between either bit string and the others, so its effect takes O(bits) to
+// compute for locality, rather than the O(N * bits) of locality(), and O(N)
+// for distance distortion, rather than O(N^2). For local optima, it only
+// changes whether either bit string or their neighbors are optima, which
+// takes O(bits^2). This is the basic move of a local search over
+// representations.
+class swappable_rep_t {
+ public:
+  // The widest representation whose distortion sum fits the score:
+  static constexpr unsigned MAX_DISTORTION_BITS = 21;
+
+  explicit swappable_rep_t(const rep_t& rep, objective_t objective = objective_t::LOCALITY)
+  : values_(rep.data(), rep.data() + rep.size()), bits_(rep.bits())
+  , objective_(objective), score_(0)
+  {
+    switch (objective_) {
+      case objective_t::LOCALITY:
+        score_ = ::locality(rep).total;
+        break;
+      case objective_t::DISTORTION:
+        assert(bits_ <= MAX_DISTORTION_BITS);
+        score_ = int64_t(distortion_sums(rep).distortion);
+        break;
+      case objective_t::OPTIMA:
+        for (const auto count : optima_census(rep)) {
+          score_ += count;
+        }
+        break;
+    }
+  }
+
+  unsigned bits() const { return bits_; }
+  uint64_t size() const { return values_.size(); }
+  const std::vector<num_t>& values() const { return values_; }
+  num_t operator[](bits_t bits) const { return values_[bits]; }
+  int64_t score() const { return score_; }
+
+  // The change in score if the values of bit strings x and y were swapped:
+  int64_t swap_delta(bits_t x, bits_t y) const
+  {
+    switch (objective_) {
+      case objective_t::LOCALITY: return locality_delta(x, y);
+      case objective_t::DISTORTION: return distortion_delta(x, y);
+      case objective_t::OPTIMA: return optima_delta(x, y);
+    }
+    return 0;
+  }
+
+  // Swap the values of bit strings x and y, returning the change in score:
+  int64_t swap(bits_t x, bits_t y)
+  {
+    const auto delta = swap_delta(x, y);
+    std::swap(values_[x], values_[y]);
+    score_ += delta;
+    return delta;
+  }
+
+ private:
+  // The distance between x and y themselves, if they're neighbors, doesn't
+  // change.
+  int64_t locality_delta(bits_t x, bits_t y) const
+  {
+    const int64_t px = values_[x], py = values_[y];
+    int64_t ret = 0;
+    for (unsigned i = 0; i < bits_; ++i) {
+      const auto nx = x ^ (bits_t(1) << i), ny = y ^ (bits_t(1) << i);
+      if (nx != y) {
+        ret += std::llabs(py - values_[nx]) - std::llabs(px - values_[nx]);
+        ret += std::llabs(px - values_[ny]) - std::llabs(py - values_[ny]);
+      }
+    }
+    // Every distance counts twice, once from each side:
+    return ret * 2;
+  }
+
+  // Nor does the pair of x and y count here:
+  int64_t distortion_delta(bits_t x, bits_t y) const
+  {
+    const int64_t px = values_[x], py = values_[y];
+    int64_t ret = 0;
+    for (bits_t z = 0; z < size(); ++z) {
+      if (z != x && z != y) {
+        const int64_t pz = values_[z];
+        const int64_t gx = __builtin_popcount(x ^ z), gy = __builtin_popcount(y ^ z);
+        ret += std::llabs(std::llabs(py - pz) - gx) - std::llabs(std::llabs(px - pz) - gx);
+        ret += std::llabs(std::llabs(px - pz) - gy) - std::llabs(std::llabs(py - pz) - gy);
+      }
+    }
+    return ret;
+  }
+
+  int64_t optima_delta(bits_t x, bits_t y) const
+  {
+    std::array<bits_t, 2 * MAX_BITS + 2> affected;
+    size_t n = 0;
+    affected[n++] = x;
+    affected[n++] = y;
+    for (unsigned i = 0; i < bits_; ++i) {
+      affected[n++] = x ^ (bits_t(1) << i);
+      affected[n++] = y ^ (bits_t(1) << i);
+    }
+    std::sort(affected.begin(), affected.begin() + n);
+    n = std::unique(affected.begin(), affected.begin() + n) - affected.begin();
+
+    int64_t ret = 0;
+    for (size_t k = 0; k < n; ++k) {
+      ret += optima_targets(affected[k], x, y, true) - optima_targets(affected[k], x, y, false);
+    }
+    return ret;
+  }
+
+  // For how many targets a bit string z is a local optimum (as in
+  // optima_census()), with the values of x and y swapped or not:
+  int64_t optima_targets(bits_t z, bits_t x, bits_t y, bool swapped) const
+  {
+    const auto value = [&](bits_t w) -> int64_t {
+      return !swapped? values_[w] : w == x? values_[y] : w == y? values_[x] : values_[w];
+    };
+    const int64_t v = value(z), n = size();
+    int64_t below = 0, above = n;
+    for (unsigned i = 0; i < bits_; ++i) {
+      const auto w = value(z ^ (bits_t(1) << i));
+      below = w < v? std::max(below, w + 1) : below;
+      above = w > v? std::min(above, w) : above;
+    }
+    const int64_t lo = below? (v + below) / 2 : 0;
+    const int64_t hi = above < n? (v + above) / 2 : n - 1;
+    return hi - lo + 1;
+  }
+
+  std::vector<num_t> values_;
+  const unsigned bits_;
+  const objective_t objective_;
+  int64_t score_;
+};
+
+
+//////////////////////
+// Symmetries of representations
+
+// The canonical form of a representation under the automorphisms of the
+// hypercube: relabeling the bit strings by x -> pi(x) ^ c, for a permutation
+// pi of the bits and any bit string c, changes neither the locality of a
+// representation nor how SA and ES behave on it. Of the 2^bits * bits!
+// equivalent representations, the canonical one is the lexicographically
+// smallest. It maps 0 to 0, so c is the bit string of value 0, and its
+// values increase over the neighbors of 0, namely 1, 2, 4..., which fixes pi.
+std::vector<num_t>
+canonical(const rep_t& rep)
+{
+  const unsigned bits = rep.bits();
+  const bits_t c = std::find(rep.data(), rep.data() + rep.size(), 0) - rep.data();
+  std::array<unsigned, MAX_BITS> pi;
+  std::iota(pi.begin(), pi.begin() + bits, 0);
+  std::sort(pi.begin(), pi.begin() + bits, [&](unsigned i, unsigned j) {
+    return rep[c ^ (bits_t(1) << i)] < rep[c ^ (bits_t(1) << j)];
+  });
+
+  // pi(x), by the bytes of x:
+  constexpr unsigned BYTES = (MAX_BITS + 7) / 8;
+  std::array<std::array<bits_t, 256>, BYTES> permuted {};
+  for (unsigned i = 0; i < bits; ++i) {
+    for (unsigned v = 0; v < 256; ++v) {
+      if ((v >> (i % 8)) & 1) {
+        permuted[i / 8][v] |= bits_t(1) << pi[i];
+      }
+    }
+  }
+
+  std::vector<num_t> ret(rep.size());
+  parallel_for(blocked_range<uint64_t>(0, rep.size()), [&](const blocked_range<uint64_t>& r) {
+    for (auto x = r.begin(); x != r.end(); ++x) {
+      bits_t y = c;
+      for (unsigned k = 0; k < BYTES; ++k) {
+        y ^= permuted[k][(x >> (8 * k)) & 0xFF];
+      }
+      ret[x] = rep[y];
+    }
+  });
+  return ret;
+}
+
+// A 64-bit hash of a representation, e.g., of a canonical form, as the key
+// of a cache. It's the size plus a sum of hashes of each bit string with its
+// value, so it's computed in parallel in any order. The size is added once,
+// after the reduction: its identity is copied into every subrange, so it
+// must be 0 for the hash not to depend on how the range is split.
+uint64_t
+rep_hash(const std::vector<num_t>& values)
 {
-  auto x = bit_neighbors(6);
-  // A few sample 3-bit representations:
-  rep_t bin = { 0, 1, 2, 3, 4, 5, 6, 7 };     // Standard binary
-  rep_t brg = { 0, 1, 3, 2, 7, 6, 4, 5 };     // Binary-reflected Gray coding
-  rep_t ngg = { 0, 7, 1, 2, 5, 6, 4, 3 };     // Another Gray coding with worse locality
-  rep_t worst = { 0, 5, 6, 3, 7, 1, 2, 4 };   // Upper-bound locality representation.
+  return values.size() + parallel_reduce(
+      blocked_range<uint64_t>(0, values.size()), uint64_t(0),
+      [&](const blocked_range<uint64_t>& r, uint64_t h) {
+        for (auto x = r.begin(); x != r.end(); ++x) {
+          // splitmix64's finalizer, of the pair (x, value):
+          uint64_t z = (x << 32 | values[x]) + 0x9E3779B97F4A7C15ULL;
+          z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+          z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+          h += z ^ (z >> 31);
+        }
+        return h;
+      },
+      std::plus<uint64_t>());
+}
+
+// Metrics of representations, kept once per canonical form: the key is the
+// hash of the canonical form (a collision of two 64-bit hashes is unlikely
+// enough to ignore), and the metrics are named values, such as "locality"
+// or "distance_distortion", kept as text so that none loses precision. The
+// cache persists in a text file, one metric per line: hash, name, and value,
+// tab-separated.
+class metrics_cache_t {
+ public:
+  explicit metrics_cache_t(const std::string& fname)
+  : fname_(fname), metrics_()
+  {
+    std::ifstream in(fname_);
+    std::string line;
+    while (std::getline(in, line)) {
+      const auto tab1 = line.find('\t'), tab2 = line.find('\t', tab1 + 1);
+      if (tab2 != std::string::npos) {
+        const auto hash = strtoull(line.c_str(), nullptr, 16);
+        metrics_[hash][line.substr(tab1 + 1, tab2 - tab1 - 1)] = line.substr(tab2 + 1);
+      }
+    }
+  }
+
+  // Look up a metric, returning whether it's there:
+  bool lookup(uint64_t hash, const std::string& name, std::string& value) const
+  {
+    const auto it = metrics_.find(hash);
+    if (it == metrics_.end() || !it->second.count(name)) {
+      return false;
+    }
+    value = it->second.at(name);
+    return true;
+  }
+
+  void insert(uint64_t hash, const std::string& name, const std::string& value)
+  {
+    metrics_[hash][name] = value;
+  }
+
+  void save() const
+  {
+    std::ofstream out(fname_);
+    if (!out) {
+      std::cerr << "Can't write " << fname_ << "\n";
+      exit(1);
+    }
+    for (const auto& [hash, metrics] : metrics_) {
+      for (const auto& [name, value] : metrics) {
+        out << std::hex << hash << std::dec << "\t" << name << "\t" << value << "\n";
+      }
+    }
+  }
+
+ private:
+  const std::string fname_;
+  std::unordered_map<uint64_t, std::map<std::string, std::string>> metrics_;
+};
+
+
+//////////////////////
+// Search for representations with extremal locality
+
+// A representation found by a search, and its score (see objective_t). Of
+// two equally good ones, the lexicographically smaller is preferred, so that
+// the result of anneal() doesn't depend on scheduling.
+struct found_t {
+  int64_t score;
+  std::vector<num_t> values;
+
+  bool better(const found_t& other, bool maximize) const
+  {
+    if (score != other.score) {
+      return maximize? score > other.score : score < other.score;
+    }
+    return values < other.values;
+  }
+};
+
+// Exhaustive search, with branch and bound, for a representation of a given
+// width with the lowest or highest locality. Bit strings are assigned values
+// in increasing order, so when bit string x is assigned, its neighbors across
+// its set bits already are. Locality doesn't change under the automorphisms
+// of the hypercube, so the search only covers canonical representations
+// (see canonical()): those that map bit string 0 to value 0, and whose
+// values increase over the neighbors of 0, namely 1, 2, 4...
+// Sums here are of phenotype distances less one, over each neighbor pair
+// once, so locality is twice the sum. Tasks prune anything that can't beat
+// the best sum found by any of them, so which of several best
+// representations is found may depend on scheduling.
+class exhaustive_search_t {
+ public:
+  static constexpr unsigned MAX_BITS = 4;
+
+  exhaustive_search_t(unsigned bits, bool maximize)
+  : bits_(bits), n_(1u << bits), maximize_(maximize)
+  , incumbent_(0)
+  {
+    assert(bits_ <= MAX_BITS);
+  }
+
+  // The best representation, or start if none is better. A good start,
+  // e.g., from anneal(), prunes much of the search.
+  found_t run(found_t start)
+  {
+    start.score /= 2;
+    incumbent_ = start.score;
 
-  std::cout << "locality of binary: " << locality(bin) << "\n";
-  std::cout << "locality of binary reflected gray: " << locality(brg) << "\n";
-  std::cout << "locality of non-greedy gray: " << locality(ngg) << "\n";
-  std::cout << "locality of worst: " << locality(worst) << "\n";
+    // Split the search tree at depth SPLIT_DEPTH, and search the subtrees
+    // in parallel, sharing the best sum found so far for pruning:
+    constexpr bits_t SPLIT_DEPTH = 3;
+    std::vector<node_t> tasks;
+    node_t root;
+    root.values[0] = 0;
+    root.used = 1;
+    root.sum = 0;
+    split(root, 1, std::min(SPLIT_DEPTH, n_), tasks);
+
+    auto ret = parallel_reduce(
+        blocked_range<size_t>(0, tasks.size(), 1), start,
+        [&](const blocked_range<size_t>& r, found_t best) {
+          for (auto t = r.begin(); t != r.end(); ++t) {
+            auto node = tasks[t];
+            search(node, std::min(SPLIT_DEPTH, n_), best);
+          }
+          return best;
+        },
+        [&](const found_t& a, const found_t& b) {
+          return a.better(b, maximize_)? a : b;
+        });
+    ret.score *= 2;
+    return ret;
+  }
+
+ private:
+  struct node_t {
+    std::array<num_t, 1u << MAX_BITS> values;
+    uint32_t used;    // Which values are assigned
+    int64_t sum;      // Over the neighbor pairs assigned so far
+  };
+
+  // Can bit string x be assigned value v, by the symmetry constraints?
+  bool allowed(const node_t& node, bits_t x, num_t v) const
+  {
+    const bool neighbor_of_0 = x > 1 && !(x & (x - 1));
+    return !((node.used >> v) & 1) && !(neighbor_of_0 && v < node.values[x >> 1]);
+  }
+
+  // Sum over the neighbor pairs that assigning v to x completes:
+  int64_t added(const node_t& node, bits_t x, num_t v) const
+  {
+    int64_t ret = 0;
+    for (unsigned i = 0; i < bits_; ++i) {
+      if ((x >> i) & 1) {
+        ret += std::llabs(int64_t(v) - node.values[x ^ (1u << i)]) - 1;
+      }
+    }
+    return ret;
+  }
+
+  // An optimistic bound on the sum over the neighbor pairs still to be
+  // completed, when bit strings 0..depth-1 are assigned. Each pair is
+  // charged to its larger bit string y, which is unassigned, and the bound
+  // for y is its best value among the unused ones, against its assigned
+  // neighbors below it. Its unassigned neighbors below it take the best of
+  // the unused values: when minimizing, they can't be nearer than the
+  // distinct values next to y's.
+  int64_t bound(const node_t& node, bits_t depth) const
+  {
+    const uint32_t unused = ~node.used & ((uint64_t(1) << n_) - 1);
+    if (!unused) {
+      return 0;
+    }
+    const int64_t lo = __builtin_ctz(unused), hi = 31 - __builtin_clz(unused);
+    int64_t ret = 0;
+    for (bits_t y = depth; y < n_; ++y) {
+      int64_t best = maximize_? 0 : INT64_MAX;
+      for (uint32_t vs = unused; vs; vs &= vs - 1) {
+        const int64_t v = __builtin_ctz(vs);
+        int64_t sum = 0;
+        for (unsigned i = 0; i < bits_; ++i) {
+          const bits_t x = y ^ (1u << i);
+          if (x < depth) {
+            sum += std::llabs(v - node.values[x]) - 1;
+          }
+        }
+        best = maximize_? std::max(best, sum) : std::min(best, sum);
+      }
+      // How many neighbors below y, and how many of them unassigned:
+      const unsigned below = __builtin_popcount(y);
+      unsigned unassigned = 0;
+      for (unsigned i = 0; i < bits_; ++i) {
+        unassigned += ((y >> i) & 1) && (y ^ (1u << i)) >= depth;
+      }
+      if (maximize_) {
+        ret += best + unassigned * (hi - lo - 1);
+      } else {
+        // The distances from y to its neighbors below are at least 1, 1, 2, 2...
+        int64_t distinct = 0;
+        for (unsigned j = 0; j < below; ++j) {
+          distinct += j / 2;
+        }
+        ret += std::max(best, distinct);
+      }
+    }
+    return ret;
+  }
+
+  // Can a node with this sum and bound still beat the best one?
+  bool promising(int64_t sum, int64_t bound) const
+  {
+    const auto best = incumbent_.load(std::memory_order_relaxed);
+    return maximize_? sum + bound > best : sum + bound < best;
+  }
+
+  // All nodes that assign bit strings up to depth, from node onwards:
+  void split(node_t& node, bits_t x, bits_t depth, std::vector<node_t>& out) const
+  {
+    if (x == depth) {
+      out.push_back(node);
+      return;
+    }
+    for (num_t v = 0; v < n_; ++v) {
+      if (allowed(node, x, v)) {
+        const auto sum = node.sum;
+        node.values[x] = v;
+        node.used |= 1u << v;
+        node.sum += added(node, x, v);
+        split(node, x + 1, depth, out);
+        node.used &= ~(1u << v);
+        node.sum = sum;
+      }
+    }
+  }
+
+  // Depth-first search from a node that assigns bit strings 0..x-1:
+  void search(node_t& node, bits_t x, found_t& best)
+  {
+    if (x == n_) {
+      const found_t found { node.sum, std::vector<num_t>(node.values.begin(), node.values.begin() + n_) };
+      if (found.better(best, maximize_)) {
+        best = found;
+        auto incumbent = incumbent_.load();
+        while ((maximize_? node.sum > incumbent : node.sum < incumbent)
+            && !incumbent_.compare_exchange_weak(incumbent, node.sum)) {
+        }
+      }
+      return;
+    }
+    for (num_t v = 0; v < n_; ++v) {
+      if (!allowed(node, x, v)) {
+        continue;
+      }
+      const auto sum = node.sum;
+      node.values[x] = v;
+      node.used |= 1u << v;
+      node.sum += added(node, x, v);
+      if (promising(node.sum, bound(node, x + 1))) {
+        search(node, x + 1, best);
+      }
+      node.used &= ~(1u << v);
+      node.sum = sum;
+    }
+  }
+
+  const unsigned bits_;
+  const bits_t n_;
+  const bool maximize_;
+  std::atomic<int64_t> incumbent_;  // The best sum found by any task
+};
+
+// Simulated annealing over representations of a given width, for the lowest
+// or highest score of an objective: independent restarts in parallel, each
+// from a random representation, by random swaps of two values, at a
+// temperature that cools geometrically from about the mean change of a swap
+// down to 1.
+found_t
+anneal(unsigned bits, objective_t objective, bool maximize, unsigned restarts,
+       uint64_t iterations, uint64_t seed)
+{
+  const found_t none { maximize? -1 : INT64_MAX, {} };
+  return parallel_reduce(
+      blocked_range<unsigned>(0, restarts, 1), none,
+      [&](const blocked_range<unsigned>& r, found_t best) {
+        for (auto restart = r.begin(); restart != r.end(); ++restart) {
+          std::mt19937_64 rng(seed + restart);
+          std::vector<num_t> values(size_t(1) << bits);
+          std::iota(values.begin(), values.end(), 0);
+          std::shuffle(values.begin(), values.end(), rng);
+          swappable_rep_t rep(rep_t(values), objective);
+          std::uniform_int_distribution<bits_t> pick(0, values.size() - 1);
+          std::uniform_real_distribution<double> uniform(0, 1);
+
+          constexpr unsigned SAMPLES = 1000;
+          double temp = 0;
+          for (unsigned i = 0; i < SAMPLES; ++i) {
+            temp += std::llabs(rep.swap_delta(pick(rng), pick(rng)));
+          }
+          temp = std::max(temp / SAMPLES, 1.);
+          const double tadj = pow(1. / temp, 1. / iterations);
+
+          found_t found { rep.score(), rep.values() };
+          for (uint64_t i = 0; i < iterations; ++i, temp *= tadj) {
+            const auto x = pick(rng), y = pick(rng);
+            const auto gain = maximize? rep.swap_delta(x, y) : -rep.swap_delta(x, y);
+            if (gain >= 0 || uniform(rng) < exp(gain / temp)) {
+              rep.swap(x, y);
+              if (maximize? rep.score() > found.score : rep.score() < found.score) {
+                found.score = rep.score();
+                found.values = rep.values();
+              }
+            }
+          }
+          if (found.better(best, maximize)) {
+            best = std::move(found);
+          }
+        }
+        return best;
+      },
+      [&](const found_t& a, const found_t& b) {
+        return a.better(b, maximize)? a : b;
+      });
+}
+
+//////////////////////
+// Gray codes
+
+// Enumeration of the Gray codes of a given width, as representations: a
+// Gray code is a Hamiltonian path on the hypercube from bit string 0, and
+// maps the i-th bit string on the path to value i (like the non-greedy Gray
+// codes of cube.py). Paths are walked depth-first, a bit flip at a time,
+// with the visited bit strings in a bitmask, and in parallel over the
+// subtrees at depth SPLIT_DEPTH. Only canonical representations are
+// enumerated (see canonical()): the paths visit the neighbors of 0 in the
+// order 1, 2, 4..., so each code stands for the bits! codes that differ from
+// it by a permutation of the bits.
+// Optionally, codes are limited to a range of locality, and paths are
+// pruned when bounds on the locality of any of their completions are out of
+// range. Paths are also pruned when some unvisited bit string can't be
+// reached, or two of them can only be reached last.
+class gray_codes_t {
+ public:
+  static constexpr unsigned MAX_BITS = 6;
+  using mask_t = uint64_t;
+
+  gray_codes_t(unsigned bits, int64_t min_locality, int64_t max_locality)
+  : bits_(bits), n_(1u << bits), min_sum_((min_locality + 1) / 2), max_sum_(max_locality / 2)
+  , limit_(0), found_(0)
+  {
+    assert(bits_ > 0 && bits_ <= MAX_BITS);
+  }
+
+  // Call f(values, locality) for Gray codes, up to limit of them (0 for
+  // all), returning how many. f is called from parallel tasks, in no
+  // particular order.
+  template <class F>
+  uint64_t enumerate(uint64_t limit, const F& f)
+  {
+    constexpr num_t SPLIT_DEPTH = 8;
+    limit_ = limit;
+    found_ = 0;
+
+    path_t root {};
+    visit(root, 0);
+    std::vector<path_t> tasks;
+    split(root, std::min(SPLIT_DEPTH, n_), tasks);
+
+    parallel_for(blocked_range<size_t>(0, tasks.size(), 1), [&](const blocked_range<size_t>& r) {
+      for (auto t = r.begin(); t != r.end(); ++t) {
+        auto path = tasks[t];
+        walk(path, f);
+      }
+    });
+    return std::min(found_.load(), limit_? limit_ : UINT64_MAX);
+  }
+
+ private:
+  struct path_t {
+    std::array<num_t, 1u << MAX_BITS> values;  // Of the visited bit strings
+    mask_t visited;
+    bits_t last;                // The end of the path
+    num_t length;               // How many bit strings visited
+    int64_t sum;                // Distances less one, over neighbor pairs both visited
+    int64_t pairs;              // How many neighbor pairs are both visited
+    int64_t frontier;           // How many pairs have just one visited...
+    int64_t frontier_values;    // ...and the sum of its values
+  };
+
+  bool done() const { return limit_ && found_.load(std::memory_order_relaxed) >= limit_; }
+
+  // Extend a path to bit string y:
+  void visit(path_t& path, bits_t y) const
+  {
+    const num_t t = path.length;
+    for (unsigned i = 0; i < bits_; ++i) {
+      const bits_t u = y ^ (1u << i);
+      if ((path.visited >> u) & 1) {
+        path.sum += t - path.values[u] - 1;
+        ++path.pairs;
+        --path.frontier;
+        path.frontier_values -= path.values[u];
+      } else {
+        ++path.frontier;
+        path.frontier_values += t;
+      }
+    }
+    path.values[y] = t;
+    path.visited |= mask_t(1) << y;
+    path.last = y;
+    ++path.length;
+  }
+
+  // Can the path continue to bit string y?
+  bool allowed(const path_t& path, bits_t y) const
+  {
+    if ((path.visited >> y) & 1) {
+      return false;
+    }
+    // Neighbors of 0 in order: 2^i only after 2^(i-1).
+    return !(y > 1 && !(y & (y - 1)) && !((path.visited >> (y >> 1)) & 1));
+  }
+
+  // Can any completion of the path be a Gray code in the locality range?
+  // Pairs with one visited bit string of value v are at least t - v and at
+  // most n - 1 - v apart, when the next value is t, and pairs with none
+  // visited are at most n - 1 - t apart.
+  bool feasible(const path_t& path) const
+  {
+    const int64_t t = path.length, n = n_;
+    const int64_t lower = path.sum + path.frontier * (t - 1) - path.frontier_values;
+    const int64_t unvisited = int64_t(n_) * bits_ / 2 - path.pairs - path.frontier;
+    const int64_t upper = path.sum + path.frontier * (n - 2) - path.frontier_values
+                        + unvisited * std::max<int64_t>(n - 2 - t, 0);
+    if (lower > max_sum_ || upper < min_sum_) {
+      return false;
+    }
+
+    // Count the unvisited bit strings with at most one way in, which the
+    // path would have to end at:
+    const mask_t unvisited_set = ~path.visited & (n_ == 64? ~mask_t(0) : (mask_t(1) << n_) - 1);
+    unsigned ends = 0;
+    for (mask_t zs = unvisited_set; zs; zs &= zs - 1) {
+      const bits_t z = __builtin_ctzll(zs);
+      unsigned degree = 0;
+      for (unsigned i = 0; i < bits_; ++i) {
+        const bits_t u = z ^ (1u << i);
+        degree += ((unvisited_set >> u) & 1) || u == path.last;
+      }
+      if (degree == 0 || (degree == 1 && ++ends > 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // All the paths of a given length, extending path:
+  void split(path_t& path, num_t length, std::vector<path_t>& out) const
+  {
+    if (path.length == length || path.length == n_) {
+      out.push_back(path);
+      return;
+    }
+    for (unsigned i = 0; i < bits_; ++i) {
+      const bits_t y = path.last ^ (1u << i);
+      if (allowed(path, y)) {
+        auto next = path;
+        visit(next, y);
+        if (feasible(next)) {
+          split(next, length, out);
+        }
+      }
+    }
+  }
+
+  template <class F>
+  void walk(path_t& path, const F& f)
+  {
+    if (done()) {
+      return;
+    }
+    if (path.length == n_) {
+      if (path.sum >= min_sum_ && path.sum <= max_sum_) {
+        const auto index = found_.fetch_add(1);
+        if (!limit_ || index < limit_) {
+          f(std::vector<num_t>(path.values.begin(), path.values.begin() + n_), path.sum * 2);
+        }
+      }
+      return;
+    }
+    for (unsigned i = 0; i < bits_; ++i) {
+      const bits_t y = path.last ^ (1u << i);
+      if (allowed(path, y)) {
+        auto next = path;
+        visit(next, y);
+        if (feasible(next)) {
+          walk(next, f);
+        }
+      }
+    }
+  }
+
+  const unsigned bits_;
+  const num_t n_;
+  const int64_t min_sum_, max_sum_;  // The locality range, in sums
+  uint64_t limit_;
+  std::atomic<uint64_t> found_;
+};
+
+// Write the header of a binary mapping library of count mappings:
+void
+write_library_header(FILE* out, unsigned bits, uint32_t count)
+{
+  const uint32_t fields[2] = { bits, count };
+  fwrite(LIBRARY_MAGIC, 1, sizeof(LIBRARY_MAGIC), out);
+  fwrite(fields, sizeof(uint32_t), 2, out);
+}
+
+// And one of its mappings, as entries of the library's size:
+void
+write_library_mapping(FILE* out, unsigned bits, const std::vector<num_t>& values)
+{
+  const size_t entry = library_entry_size(bits);
+  for (const auto v : values) {
+    fwrite(&v, entry, 1, out);  // Little endian
+  }
+}
+
+// Write a representation as a library of one mapping (so onemax -L can run
+// it): as a line of decimal text, or as a binary library.
+void
+write_rep(const std::vector<num_t>& values, const std::string& fname, bool binary)
+{
+  FILE* out = fopen(fname.c_str(), binary? "wb" : "w");
+  if (!out) {
+    std::cerr << "Can't write " << fname << "\n";
+    exit(1);
+  }
+  unsigned bits = 0;
+  while ((size_t(1) << bits) < values.size()) {
+    ++bits;
+  }
+  if (binary) {
+    write_library_header(out, bits, 1);
+    write_library_mapping(out, bits, values);
+  } else {
+    for (size_t i = 0; i < values.size(); ++i) {
+      fprintf(out, i + 1 < values.size()? "%u " : "%u\n", values[i]);
+    }
+  }
+  if (fclose(out)) {
+    std::cerr << "Can't write " << fname << "\n";
+    exit(1);
+  }
+}
+
+
+// All the command-line options:
+struct config_t {
+  bool binary = false;          // Read and write representations as binary
+  std::string goal = "";        // Search for a representation with min or max objective
+  std::string objective = "locality";  // To search on
+  unsigned bits = 0;            // Of the representation to search for
+  bool exhaustive = false;      // Also search exhaustively
+  unsigned restarts = RESTARTS;
+  uint64_t iterations = 0;      // Swaps per restart (0: by the width)
+  uint64_t seed = std::random_device()();
+  std::string out = "";         // File for the representation found
+  bool canonical = false;       // Output the canonical form of the representation read
+  std::string cache = "";       // Metrics cache file
+  bool distortion = false;      // Also compute distance distortion
+  bool optima = false;          // Output the local optima for every a instead
+  unsigned gray = 0;            // Enumerate Gray codes of this width
+  uint64_t codes = 1;           // How many of them (0 for all)
+  int64_t min_locality = 0;     // Of the Gray codes enumerated
+  int64_t max_locality = INT64_MAX;
+};
+
+void usage()
+{
+  std::cerr << "Usage: locality [-b] [-c] [-d] [-O] [-C cache] [file]\n";
+  std::cerr << "       locality -M goal -n bits [options]\n";
+  std::cerr << "       locality -G bits [-k n] [-l max] [-u min]\n";
+  std::cerr << "file:\tA representation of N bits, up to " << MAX_BITS << ": a permutation of\n";
+  std::cerr << "\tthe values 0..2^N-1, as decimal text, or - for standard input\n";
+  std::cerr << "Options:\n";
+  std::cerr << "-b:\tThe file is binary, native 32-bit values or a mapping library\n";
+  std::cerr << "\t(of which the first mapping is used), and is memory-mapped\n";
+  std::cerr << "-c:\tOutput the canonical form of the representation, under the\n";
+  std::cerr << "\tautomorphisms of the hypercube, rather than its locality\n";
+  std::cerr << "-d:\tAlso compute the distance distortion, over all pairs of bit strings\n";
+  std::cerr << "-O:\tOutput the number of local optima of the one-max fitness for\n";
+  std::cerr << "\tevery value of a, rather than the locality\n";
+  std::cerr << "-C cache:\tLook up the metrics of the representation, or of any\n";
+  std::cerr << "\tequivalent one, in a cache file, and add them there if they're missing\n";
+  std::cerr << "\t(reports the total locality only)\n";
+  std::cerr << "-M goal:\tRather than read a representation, search for one with min\n";
+  std::cerr << "\tor max objective, by simulated annealing\n";
+  std::cerr << "-m obj:\tThe objective: locality (default), distortion (the distance\n";
+  std::cerr << "\tdistortion, which takes O(N) per swap, so is for up to about 10 bits),\n";
+  std::cerr << "\tor optima (the mean number of local optima of one-max over all a)\n";
+  std::cerr << "-n bits:\tWidth of the representation to search for\n";
+  std::cerr << "-x:\tThen search exhaustively, with branch and bound, for a provably\n";
+  std::cerr << "\tbest one, by locality only (up to " << exhaustive_search_t::MAX_BITS;
+  std::cerr << " bits, which takes minutes per core;";
+  std::cerr << " default for up to " << EXHAUSTIVE_BITS << " bits)\n";
+  std::cerr << "-R n:\tNumber of simulated annealing restarts (default: " << RESTARTS << ")\n";
+  std::cerr << "-i n:\tSwaps per restart (default: " << ITERATIONS_PER_VALUE;
+  std::cerr << " per value of the representation)\n";
+  std::cerr << "-s seed:\tMaster random seed (default: random, reported on stderr)\n";
+  std::cerr << "-o file:\tWrite the representation found (or the canonical form) to file,\n";
+  std::cerr << "\tas a mapping library for onemax -L (binary with -b)\n";
+  std::cerr << "-G bits:\tRather than read a representation, enumerate Gray codes of up to\n";
+  std::cerr << "\t" << gray_codes_t::MAX_BITS << " bits (Hamiltonian paths from 0), one per line, up to a\n";
+  std::cerr << "\tpermutation of the bits, as a mapping library for onemax -L (binary\n";
+  std::cerr << "\twith -b and -o)\n";
+  std::cerr << "-k n:\tHow many Gray codes to enumerate (default: 1; 0 for all)\n";
+  std::cerr << "-l max:\tOnly Gray codes with at most this locality\n";
+  std::cerr << "-u min:\tOnly Gray codes with at least this locality\n";
+}
+
+// Output a representation to the file in cfg, or to stdout:
+void output_rep(const config_t& cfg, const std::vector<num_t>& values)
+{
+  if (cfg.out.empty()) {
+    std::cout << "representation:";
+    for (const auto v : values) {
+      std::cout << " " << v;
+    }
+    std::cout << "\n";
+  } else {
+    write_rep(values, cfg.out, cfg.binary);
+  }
+}
+
+// Format a metric, e.g., for the metrics cache:
+std::string format_metric(double value)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.17g", value);
+  return buf;
+}
+
+void print_metrics(const config_t& cfg, const rep_t& rep)
+{
+  if (!cfg.cache.empty()) {
+    metrics_cache_t cache(cfg.cache);
+    const auto hash = rep_hash(canonical(rep));
+    bool changed = false;
+    // A metric from the cache, or computed and added to the cache:
+    const auto metric = [&](const std::string& name, const auto& compute) {
+      std::string value;
+      if (!cache.lookup(hash, name, value)) {
+        value = compute();
+        cache.insert(hash, name, value);
+        changed = true;
+      }
+      return value;
+    };
+
+    std::cout << "locality: "
+              << metric("locality", [&] { return std::to_string(locality(rep).total); }) << "\n";
+    if (cfg.distortion) {
+      // Both distortions come from the same pass, so compute them at most once:
+      std::optional<distortion_t> dd;
+      const auto get_dd = [&] {
+        if (!dd) {
+          dd = distance_distortion(rep);
+        }
+        return *dd;
+      };
+      std::cout << "distance distortion: "
+                << metric("distance_distortion",
+                          [&] { return format_metric(get_dd().distortion); })
+                << "\n";
+      std::cout << "distance distortion (triangle): "
+                << metric("distance_distortion_triangle",
+                          [&] { return format_metric(get_dd().triangle); })
+                << "\n";
+    }
+    if (changed) {
+      cache.save();
+    }
+    return;
+  }
+
+  const auto loc = locality(rep);
+  std::cout << "locality: " << loc.total << "\n";
+  for (unsigned i = 0; i < rep.bits(); ++i) {
+    std::cout << "locality of bit " << i << ": " << loc.by_bit[i] << "\n";
+  }
+  if (cfg.distortion) {
+    const auto dd = distance_distortion(rep);
+    std::cout << "distance distortion: " << format_metric(dd.distortion) << "\n";
+    std::cout << "distance distortion (triangle): " << format_metric(dd.triangle) << "\n";
+  }
+}
+
+// Search for a representation with an extremal objective, and report it:
+int search(config_t cfg)
+{
+  static const std::map<std::string, objective_t> objectives = {
+    { "locality", objective_t::LOCALITY },
+    { "distortion", objective_t::DISTORTION },
+    { "optima", objective_t::OPTIMA },
+  };
+  const auto obj = objectives.find(cfg.objective);
+  if ((cfg.goal != "min" && cfg.goal != "max") || obj == objectives.end()) {
+    usage();
+    return 1;
+  }
+  const bool maximize = cfg.goal == "max";
+  const auto objective = obj->second;
+  if (objective == objective_t::LOCALITY) {
+    cfg.exhaustive |= cfg.bits <= EXHAUSTIVE_BITS;
+  } else if (cfg.exhaustive) {
+    std::cerr << "Can only search exhaustively on locality\n";
+    return 1;
+  }
+  if (cfg.bits == 0 || cfg.bits > MAX_BITS
+      || (cfg.exhaustive && cfg.bits > exhaustive_search_t::MAX_BITS)
+      || (objective == objective_t::DISTORTION && cfg.bits > swappable_rep_t::MAX_DISTORTION_BITS)) {
+    std::cerr << "Can't search for representations of " << cfg.bits << " bits\n";
+    return 1;
+  }
+
+  if (!cfg.iterations) {
+    cfg.iterations = ITERATIONS_PER_VALUE << cfg.bits;
+  }
+  std::cerr << "Random seed: " << cfg.seed << "\n";
+  auto found = anneal(cfg.bits, objective, maximize, cfg.restarts, cfg.iterations, cfg.seed);
+  if (cfg.exhaustive) {
+    // The annealed representation is the one to beat:
+    found = exhaustive_search_t(cfg.bits, maximize).run(found);
+  }
+
+  const double n = found.values.size();
+  switch (objective) {
+    case objective_t::LOCALITY:
+      std::cout << "locality: " << found.score << "\n";
+      break;
+    case objective_t::DISTORTION:
+      std::cout << "distance distortion: " << format_metric(found.score / (n * (n - 1) / 2)) << "\n";
+      break;
+    case objective_t::OPTIMA:
+      std::cout << "mean local optima: " << format_metric(found.score / n) << "\n";
+      break;
+  }
+  output_rep(cfg, found.values);
+  return 0;
+}
+
+// Enumerate Gray codes, and output them as a mapping library (see
+// onemax.cc's mapping_library_t): as text, one representation per line, or
+// with -b, in the binary format, whose header has the number of mappings,
+// known only at the end.
+int enumerate_gray_codes(const config_t& cfg)
+{
+  if (cfg.gray > gray_codes_t::MAX_BITS) {
+    std::cerr << "Gray codes are limited to " << gray_codes_t::MAX_BITS << " bits\n";
+    return 1;
+  }
+  const bool binary = cfg.binary && !cfg.out.empty();
+  FILE* out = cfg.out.empty()? stdout : fopen(cfg.out.c_str(), binary? "wb" : "w");
+  if (!out) {
+    std::cerr << "Can't write " << cfg.out << "\n";
+    return 1;
+  }
+  if (binary) {
+    write_library_header(out, cfg.gray, 0);
+  }
+
+  spin_mutex mutex;
+  const auto found = gray_codes_t(cfg.gray, cfg.min_locality, cfg.max_locality)
+      .enumerate(cfg.codes, [&](const std::vector<num_t>& values, int64_t) {
+        std::string line;
+        if (!binary) {
+          for (const auto v : values) {
+            line += std::to_string(v) + " ";
+          }
+          line.back() = '\n';
+        }
+        spin_mutex::scoped_lock lock(mutex);
+        if (binary) {
+          write_library_mapping(out, cfg.gray, values);
+        } else {
+          fputs(line.c_str(), out);
+        }
+      });
+
+  if (binary) {
+    fseek(out, 0, SEEK_SET);
+    write_library_header(out, cfg.gray, found);
+  }
+  if (out != stdout && fclose(out)) {
+    std::cerr << "Can't write " << cfg.out << "\n";
+    return 1;
+  }
+  std::cerr << "Gray codes: " << found << "\n";
   return 0;
 }
 
+int main(int argc, char* argv[])
+{
+  config_t cfg;
+  int opt;
+  while ((opt = getopt(argc, argv, "bcdOC:M:m:n:xR:i:s:o:G:k:l:u:")) != -1) {
+    switch (opt) {
+      case 'b': cfg.binary = true; break;
+      case 'c': cfg.canonical = true; break;
+      case 'd': cfg.distortion = true; break;
+      case 'O': cfg.optima = true; break;
+      case 'G': cfg.gray = atoi(optarg); break;
+      case 'k': cfg.codes = strtoull(optarg, nullptr, 0); break;
+      case 'l': cfg.max_locality = strtoll(optarg, nullptr, 0); break;
+      case 'u': cfg.min_locality = strtoll(optarg, nullptr, 0); break;
+      case 'C': cfg.cache = optarg; break;
+      case 'M': cfg.goal = optarg; break;
+      case 'm': cfg.objective = optarg; break;
+      case 'n': cfg.bits = atoi(optarg); break;
+      case 'x': cfg.exhaustive = true; break;
+      case 'R': cfg.restarts = atoi(optarg); break;
+      case 'i': cfg.iterations = strtoull(optarg, nullptr, 0); break;
+      case 's': cfg.seed = strtoull(optarg, nullptr, 0); break;
+      case 'o': cfg.out = optarg; break;
+      default: usage(); return 1;
+    }
+  }
+
+  if (!cfg.goal.empty()) {
+    return search(cfg);
+  }
+  if (cfg.gray) {
+    return enumerate_gray_codes(cfg);
+  }
+
+  if (optind == argc) {
+    usage();
+    // A few sample 3-bit representations:
+    rep_t bin = { 0, 1, 2, 3, 4, 5, 6, 7 };     // Standard binary
+    rep_t brg = { 0, 1, 3, 2, 7, 6, 4, 5 };     // Binary-reflected Gray coding
+    rep_t ngg = { 0, 7, 1, 2, 5, 6, 4, 3 };     // Another Gray coding with worse locality
+    rep_t worst = { 0, 5, 6, 3, 7, 1, 2, 4 };   // Upper-bound locality representation.
+
+    std::cout << "locality of binary: " << locality(bin).total << "\n";
+    std::cout << "locality of binary reflected gray: " << locality(brg).total << "\n";
+    std::cout << "locality of non-greedy gray: " << locality(ngg).total << "\n";
+    std::cout << "locality of worst: " << locality(worst).total << "\n";
+    return 0;
+  }
+
+  const std::string fname = argv[optind];
+  std::unique_ptr<rep_t> rep;
+  if (cfg.binary) {
+    rep = std::make_unique<rep_t>(fname);
+  } else {
+    FILE* in = fname == "-"? stdin : fopen(fname.c_str(), "r");
+    if (!in) {
+      std::cerr << "Can't read " << fname << "\n";
+      return 1;
+    }
+    rep = std::make_unique<rep_t>(read_text(in));
+    fclose(in);
+  }
+  if (!is_representation(*rep)) {
+    std::cerr << fname << " isn't a permutation of 0..2^N-1, for N up to " << MAX_BITS << "\n";
+    return 1;
+  }
+
+  if (cfg.canonical) {
+    output_rep(cfg, canonical(*rep));
+  } else if (cfg.optima) {
+    const auto optima = optima_census(*rep);
+    std::cout << "# a\tlocal_optima\n";
+    for (uint64_t a = 0; a < optima.size(); ++a) {
+      std::cout << a << "\t" << optima[a] << "\n";
+    }
+  } else {
+    print_metrics(cfg, *rep);
+  }
+  return 0;
+}
@@ -3,10 +3,13 @@
  * on the generalized integer One-Max problem from Rothlauf's book:
  * "Representations for Genetic and Evolutionary Algorithms", 2nd ed., Sec. 5.4.2.
  *
- * In main(), you can control all simulation parameters, including which
- * representation to use, which fitness function, and SA/ES generations.
- * Prerequisite: Intel TBB library (libtbb-dev on debian distributions).
- * If you don't have TBB, use the commented-out loop in main().
+ * From the command line you can control all simulation parameters, including
+ * which representation to use, which fitness function, and SA/ES generations
+ * (run without arguments for a list). Each combination of algorithm,
+ * representation, and fitness function is a separate template instantiation,
+ * so the fitness evaluations in the inner loop are fully inlined.
+ * Prerequisite: Intel TBB library (libtbb-dev on debian distributions), which
+ * all the engines use for their parallel loops and reductions.
  *
  * Compile with:
    g++ -Wall -Wextra -pedantic -O3 -march=native -std=c++17 onemax.cc  -ltbb -o onemax
@@ -15,93 +18,330 @@
  */
 
 #include <algorithm>
-#include <atomic>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
-#include <functional>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/parallel_sort.h"
 #include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
 using namespace tbb;
 
-std::random_device randdev;
-using bits_t = std::vector<bool>;
+/*
+ * A small, fast pseudo-random generator (xoshiro256**, by Blackman & Vigna),
+ * usable with the standard <random> distributions. Every Sim owns one, seeded
+ * once from a master seed and the Sim's index (see stream()), so a run with a
+ * given seed is reproducible regardless of how its Sims are scheduled on
+ * threads.
+ */
+class rng_t {
+ public:
+  using result_type = uint64_t;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type(0); }
+
+  // Seed the 256-bit state from a 64-bit seed, by running it through
+  // splitmix64, as recommended by the xoshiro authors.
+  explicit rng_t(uint64_t seed = 0)
+  {
+    for (auto& s : s_) {
+      s = splitmix64(seed);
+    }
+  }
+
+  // Independent stream number 'index' of a master seed: each stream consumes
+  // its own four consecutive splitmix64 outputs, so no two streams start
+  // from the same state.
+  static rng_t stream(uint64_t seed, uint64_t index)
+  {
+    return rng_t(seed + index * 4 * SPLITMIX_INC);
+  }
+
+  // The raw generator state, e.g., to spread it over vector lanes:
+  const std::array<uint64_t, 4>& state() const { return s_; }
+
+  result_type operator()()
+  {
+    const auto ret = rotl(s_[1] * 5, 7) * 9;
+    const auto t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return ret;
+  }
+
+ private:
+  static constexpr uint64_t SPLITMIX_INC = 0x9e3779b97f4a7c15ULL;
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  static uint64_t splitmix64(uint64_t& state)
+  {
+    auto z = (state += SPLITMIX_INC);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  std::array<uint64_t, 4> s_;
+};
+
+/*
+ * A bits_t is a packed, fixed-length bit sequence (a genotype). Bit 0 is the
+ * leftmost (most significant) bit, as printed, so for up to 64 bits the first
+ * word holds exactly the standard-binary value of the sequence. Short
+ * sequences are stored inline, so copying one is a couple of register moves;
+ * only sequences longer than INLINE_WORDS words spill to the heap.
+ * Unused bits in the top word are always kept zero.
+ */
+class bits_t {
+ public:
+  using word_t = uint64_t;
+  static constexpr size_t WORD_BITS = 64;
+  static constexpr size_t INLINE_WORDS = 2;
+
+  explicit bits_t(size_t len = 0)
+  : len_(len), inline_{}, heap_(nwords() > INLINE_WORDS? nwords() : 0)
+  {}
+
+  size_t size() const { return len_; }
+  size_t nwords() const { return (len_ + WORD_BITS - 1) / WORD_BITS; }
+
+  // Raw word access. Word 0 holds the last (least significant) 64 bits.
+  word_t* words() { return heap_.empty()? inline_.data() : heap_.data(); }
+  const word_t* words() const { return heap_.empty()? inline_.data() : heap_.data(); }
+
+  // Mask of the valid bits in word w:
+  word_t word_mask(size_t w) const
+  {
+    const auto rem = len_ - w * WORD_BITS;
+    return rem >= WORD_BITS? ~word_t(0) : (word_t(1) << rem) - 1;
+  }
+
+  bool operator[](size_t idx) const { return (words()[word_of(idx)] >> bit_of(idx)) & 1; }
+  void flip(size_t idx) { words()[word_of(idx)] ^= word_t(1) << bit_of(idx); }
+
+  // Number of set bits:
+  size_t count() const
+  {
+    size_t ret = 0;
+    const auto w = words();
+    for (size_t i = 0; i < nwords(); ++i) {
+      ret += __builtin_popcountll(w[i]);
+    }
+    return ret;
+  }
+
+  // The whole sequence as a single integer (only for up to 64 bits).
+  word_t to_word() const { assert(len_ <= WORD_BITS); return inline_[0]; }
+
+  bool operator==(const bits_t& other) const
+  {
+    return len_ == other.len_ && std::equal(words(), words() + nwords(), other.words());
+  }
+
+ private:
+  size_t word_of(size_t idx) const { assert(idx < len_); return (len_ - 1 - idx) / WORD_BITS; }
+  size_t bit_of(size_t idx) const { return (len_ - 1 - idx) % WORD_BITS; }
+
+  size_t len_;
+  std::array<word_t, INLINE_WORDS> inline_;
+  std::vector<word_t> heap_;
+};
+
+// How Organism::mutate_all() picks the bits to flip: by drawing a random
+// number for every bit, or by drawing the geometrically-distributed gaps
+// between consecutive flipped bits. Both flip every bit independently with
+// probability p_m, but the cost of GEOMETRIC grows with the number of
+// flipped bits rather than with the length of the genotype.
+enum class mutation_t { BITWISE, GEOMETRIC };
+
+using phenotype_t = uint64_t;
 
 /*
  * An Organism lets you construct a random bit sequence, mutate, and compute
- * its fitness.
+ * its fitness. The fitness function is a policy type (see the fitness
+ * policies below). An Organism caches its phenotype and fitness, and updates
+ * them incrementally when a single bit is flipped.
  */
 
+template <class Fitness>
 class Organism {
  public:
-  using fitness_fun_t = std::function<double (const bits_t&)>;
-
   // Construct a random sequence of 'len' bits, with a given fitness function
-  // and mutation probability.
-  Organism(size_t len, fitness_fun_t fit, double p_m)
-  : bits_(len), fitness_(fit), p_m_(p_m)
+  // and mutation probability and method, drawing the bits from the generator reng.
+  Organism(size_t len, const Fitness& fit, double p_m, mutation_t mutation, rng_t& reng)
+  : bits_(len), fit_(fit), p_m_(p_m), log_q_(std::log1p(-p_m)), mutation_(mutation)
   {
-    std::default_random_engine reng(randdev());
-    std::uniform_real_distribution dist(0., 1.);
+    std::uniform_int_distribution<bits_t::word_t> dist;
 
-    for (size_t i = 0; i < len; ++i) {
-      if (dist(reng) < 0.5) {
-        flip(i);
-      }
+    const auto w = bits_.words();
+    for (size_t i = 0; i < bits_.nwords(); ++i) {
+      w[i] = dist(reng) & bits_.word_mask(i);
     }
+    evaluate();
   }
 
-  double fitness() const { return fitness_(bits_); }  // Compute fitness
+  double fitness() const { return fitness_; }  // Cached fitness
+
+  // Replace the bits with a genotype packed in a word (for up to 63 bits):
+  void assign(bits_t::word_t word)
+  {
+    assert(bits_.nwords() == 1);
+    bits_.words()[0] = word & bits_.word_mask(0);
+    evaluate();
+  }
 
-  void flip(size_t idx) { bits_[idx] = bits_[idx] xor 1; }   // Flip a single bit
+  // Flip a single bit, and update the fitness from the change in phenotype
+  void flip(size_t idx)
+  {
+    bits_.flip(idx);
+    phenotype_ = fit_.flip(phenotype_, bits_, idx);
+    fitness_ = fit_.score(phenotype_, bits_.size());
+  }
 
   // Mutate all bits with probability p_m_
-  void mutate_all()
+  void mutate_all(rng_t& reng)
   {
-    std::default_random_engine reng(randdev());
+    if (mutation_ == mutation_t::GEOMETRIC) {
+      mutate_geometric(reng);
+      return;
+    }
+
     std::uniform_real_distribution dist(0., 1.);
 
     for (size_t i = 0; i < bits_.size(); ++i) {
       if (dist(reng) < p_m_) {
-        flip(i);
+        bits_.flip(i);
       }
     }
+    evaluate();
   }
 
-  friend std::ostream& operator<<(std::ostream&, const Organism&);
+  template <class F>
+  friend std::ostream& operator<<(std::ostream&, const Organism<F>&);
 
  private:
+  // Mutate all bits with probability p_m_, by skipping directly from one
+  // flipped bit to the next. The number of unflipped bits before the next
+  // flip is geometric: floor(log(U) / log(1 - p_m_)) for a uniform U in (0,1].
+  void mutate_geometric(rng_t& reng)
+  {
+    std::uniform_real_distribution dist(0., 1.);
+
+    if (p_m_ <= 0) {
+      return;
+    }
+    for (size_t i = 0; ; ++i) {
+      const auto gap = std::floor(std::log1p(-dist(reng)) / log_q_);
+      if (gap >= double(bits_.size() - i)) {
+        break;
+      }
+      i += size_t(gap);
+      bits_.flip(i);
+    }
+    evaluate();
+  }
+
+  // Recompute the phenotype and fitness from scratch:
+  void evaluate()
+  {
+    phenotype_ = fit_.phenotype(bits_);
+    fitness_ = fit_.score(phenotype_, bits_.size());
+  }
+
   bits_t bits_;
-  fitness_fun_t fitness_;
+  Fitness fit_;
+  phenotype_t phenotype_;
+  double fitness_;
   double p_m_;
+  double log_q_;   // log(1 - p_m_)
+  mutation_t mutation_;
 };
 
+template <class Fitness>
 std::ostream&
-operator<<(std::ostream& os, const Organism& o)
+operator<<(std::ostream& os, const Organism<Fitness>& o)
 {
-  for (auto b : o.bits_) {
-    os << (b? "1" : "0");
+  for (size_t i = 0; i < o.bits_.size(); ++i) {
+    os << (o.bits_[i]? "1" : "0");
   }
   return os;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
+// Which evolutionary algorithm a Sim runs in each generation:
+enum class algorithm_t { SA, ES };
+
 // A Sim class runs a single-organism simulated annealing or (1+1)-Es with a
 // specified initial temperature, temperature adjustment factor, and a number
-// of genotype in Organism units of a given length
+// of genotype in Organism units of a given length.
+// The algorithm is chosen at compile time by the ALG parameter, and
+// generation() runs one generation of it.
+// A Sim keeps a running total of its organisms' fitness and of how many of
+// them are optimal, updated only when an offspring replaces its parent.
+template <class Fitness, algorithm_t ALG>
 class Sim {
  public:
-  Sim(size_t units, size_t len, Organism::fitness_fun_t f, double p_m,
-      double temp = 50, double t_adjust = 0.995)
-  : genotype_(), temp_(temp), tadj_(t_adjust), eng_(randdev())
+  using organism_t = Organism<Fitness>;
+
+  // The Sim draws all of its random numbers, including the initial
+  // organisms, from its own generator eng.
+  Sim(size_t units, size_t len, const Fitness& f, double p_m, mutation_t mutation,
+      const rng_t& eng, double temp = 50, double t_adjust = 0.995)
+  : genotype_(), optimum_(f.optimum(len)), sum_fitness_(0), num_optimal_(0)
+  , temp_(temp), tadj_(t_adjust), eng_(eng)
   , prob_dist_(0., 1.), org_dist_(0, units - 1), bit_dist_(0, len - 1)
   {
     for (size_t i = 0; i < units; ++i) {
-      genotype_.push_back(Organism(len, f, p_m));
+      genotype_.push_back(organism_t(len, f, p_m, mutation, eng_));
+      sum_fitness_ += genotype_.back().fitness();
+      num_optimal_ += genotype_.back().fitness() == optimum_;
+    }
+  }
+
+  // Start all the organisms at the same genotype, packed in a word:
+  void start_at(bits_t::word_t word)
+  {
+    sum_fitness_ = 0;
+    num_optimal_ = 0;
+    for (auto& o : genotype_) {
+      o.assign(word);
+      sum_fitness_ += o.fitness();
+      num_optimal_ += o.fitness() == optimum_;
+    }
+  }
+
+  void generation()
+  {
+    if constexpr (ALG == algorithm_t::SA) {
+      SA_generation();
+    } else {
+      ES_generation();
     }
   }
 
@@ -119,7 +359,7 @@ class Sim {
     const auto f1 = neworg.fitness();
 
     if (f1 > f0 || prob_dist_(eng_) < exp((f1 - f0) / temp_)) {
-      genotype_[org] = neworg;
+      replace(org, neworg);
     }
 
     temp_ *= tadj_;
@@ -134,41 +374,55 @@ class Sim {
     auto neworg = genotype_[org];
 
     const auto f0 = neworg.fitness();
-    neworg.mutate_all();
+    neworg.mutate_all(eng_);
     const auto f1 = neworg.fitness();
 
     if (f1 > f0) {
-       genotype_[org] = neworg;
+      replace(org, neworg);
     }
   }
 
   // Count how many organisms have optimal fitness
-  unsigned num_optimal(double optimum) const
-  {
-    return std::count_if(genotype_.cbegin(), genotype_.cend(),
-        [=](const Organism& o) { return o.fitness() == optimum; });
-  }
+  unsigned num_optimal() const { return num_optimal_; }
+
+  // Have all organisms reached the optimal fitness?
+  bool solved() const { return num_optimal_ == genotype_.size(); }
 
   // Sum up individual organisms' fitness into one fitness:
-  double fitness() const
-  {
-    return std::accumulate(genotype_.cbegin(), genotype_.cend(), 0,
-        [](double sum, const Organism& o) { return sum + o.fitness(); });
-  }
+  double fitness() const { return sum_fitness_; }
+
+  // The number of organisms, and the fitness of organism org:
+  size_t size() const { return genotype_.size(); }
+  double fitness(size_t org) const { return genotype_[org].fitness(); }
 
-  friend std::ostream& operator<<(std::ostream&, const Sim&);
+  template <class F, algorithm_t A>
+  friend std::ostream& operator<<(std::ostream&, const Sim<F, A>&);
 
  private:
-  std::vector<Organism> genotype_;
+  // Replace organism number org with an accepted offspring, and update the
+  // running totals:
+  void replace(size_t org, const organism_t& neworg)
+  {
+    const auto& old = genotype_[org];
+    sum_fitness_ += neworg.fitness() - old.fitness();
+    num_optimal_ += int(neworg.fitness() == optimum_) - int(old.fitness() == optimum_);
+    genotype_[org] = neworg;
+  }
+
+  std::vector<organism_t> genotype_;
+  const double optimum_;
+  double sum_fitness_;
+  unsigned num_optimal_;
   double temp_;
   const double tadj_;
-  std::default_random_engine eng_;
+  rng_t eng_;
   std::uniform_real_distribution<double> prob_dist_;
   std::uniform_int_distribution<size_t> org_dist_, bit_dist_;
 };
 
+template <class Fitness, algorithm_t ALG>
 std::ostream&
-operator<<(std::ostream& os, const Sim& sim)
+operator<<(std::ostream& os, const Sim<Fitness, ALG>& sim)
 {
   for (const auto& o : sim.genotype_) {
     os << "\t" << o << "\tFitness: " << sim.fitness();
@@ -179,48 +433,231 @@ operator<<(std::ostream& os, const Sim& sim)
 /////////////////////////////////////////////////////////////////////////////
 // Collection of representation encodings. A representation is
 // a mapping from a bit vector (genotype) to an integer value (phenotype).
+// Each encoding also has a policy type (below) that fitness functions
+// are templated on, with a decoder and an encoder for packed genotypes.
 
-using phenotype_t = uint64_t;
-using rep_t = std::function<phenotype_t (const bits_t&)>;
-
-// Standard binary encoding: phenotype and genotype are identical:
+// Standard binary encoding: phenotype and genotype are identical, so the
+// packed word already is the phenotype:
 phenotype_t
 std_binary_rep(const bits_t& bits)
 {
-  phenotype_t ret = 0;
-  int p = 1;
-  for (auto bit = bits.crbegin(); bit != bits.crend(); bit++, p++) {
-    ret += phenotype_t(*bit) << (p - 1);
-  }
+  assert(bits.size() < bits_t::WORD_BITS);
+  const phenotype_t ret = bits.to_word();
   assert(ret < (phenotype_t(1) << bits.size()));
   return ret;
 }
 
-// Binary-reflected gray encoding
-phenotype_t
-brg_rep(const bits_t& bits)
+// Binary-reflected gray encoding: each binary digit is the XOR of all the gray
+// digits above it, i.e., a prefix-XOR from the MSB down, which takes
+// log2(64) shift/xor steps on the packed word.
+inline phenotype_t
+brg_decode(bits_t::word_t word)
 {
-  auto it = bits.cbegin();
-  phenotype_t ret = phenotype_t(*it);
+  phenotype_t ret = word;
+  ret ^= ret >> 1;
+  ret ^= ret >> 2;
+  ret ^= ret >> 4;
+  ret ^= ret >> 8;
+  ret ^= ret >> 16;
+  ret ^= ret >> 32;
+  return ret;
+}
 
-  for (it++; it != bits.cend(); ++it) {
-    const auto prev_bit = ret & 0x1;
-    ret <<= 1;
-    ret |= (*it)? prev_bit ^ 1 : prev_bit;
-  }
+// And back: each gray digit is the XOR of two adjacent binary digits.
+inline bits_t::word_t
+brg_encode(phenotype_t p)
+{
+  return p ^ (p >> 1);
+}
 
+phenotype_t
+brg_rep(const bits_t& bits)
+{
+  assert(bits.size() < bits_t::WORD_BITS);
+  const auto ret = brg_decode(bits.to_word());
   assert(ret < (phenotype_t(1) << bits.size()));
   return ret;
 }
 
-// Representation from an explicit mapping of bits to values.
-// The mapping is given as an array, where the value in the n-th location
-// is the mapped value from the n-th bitstring (using standrard binary ordering)
+// An explicit mapping of bits to values, as a table where the value in the
+// n-th location is the mapped value from the n-th bitstring (using standard
+// binary ordering). Entries are of the narrowest unsigned type that holds
+// len bits, so a 24-bit table takes 64 MiB rather than 128 MiB, and an 8-bit
+// one fits in four cache lines. A table is either a view of entries owned
+// elsewhere, such as a memory-mapped library file (so all threads share one
+// page-cache copy, and no copy is made), or a copy in
+// anonymous memory of its own, optionally on huge pages, which saves TLB
+// misses on random lookups into wide tables.
+class explicit_table_t {
+ public:
+  using word_t = bits_t::word_t;
+  static constexpr size_t HUGE_PAGE = size_t(2) << 20;
+
+  // The size of an entry of a table of len bits:
+  static size_t entry_size(size_t len) { return len <= 8? 1 : len <= 16? 2 : 4; }
+
+  // A view of the table of len bits at data:
+  explicit_table_t(const void* data, size_t len)
+  : data_(data), len_(len), width_(entry_size(len)), owned_(nullptr), owned_size_(0)
+  {
+    assert(len_ < 32);
+  }
+
+  // A copy of the 2^len values at first, narrowed to the entry size:
+  template <class Value>
+  explicit_table_t(const Value* first, size_t len, bool huge_pages)
+  : explicit_table_t(nullptr, len)
+  {
+    void* data = allocate(huge_pages);
+    switch (width_) {
+      case 1: std::copy(first, first + size(), static_cast<uint8_t*>(data)); break;
+      case 2: std::copy(first, first + size(), static_cast<uint16_t*>(data)); break;
+      default: std::copy(first, first + size(), static_cast<uint32_t*>(data)); break;
+    }
+  }
+
+  // A copy of another table, e.g., to move a file-backed one to huge pages:
+  explicit_table_t(const explicit_table_t& other, bool huge_pages)
+  : explicit_table_t(nullptr, other.len_)
+  {
+    memcpy(allocate(huge_pages), other.data_, bytes());
+  }
+
+  explicit_table_t(const explicit_table_t&) = delete;
+  explicit_table_t& operator=(const explicit_table_t&) = delete;
+
+  ~explicit_table_t()
+  {
+    if (owned_) {
+      munmap(owned_, owned_size_);
+    }
+  }
+
+  size_t len() const { return len_; }
+  size_t size() const { return size_t(1) << len_; }
+  size_t bytes() const { return size() * width_; }
+
+  phenotype_t operator[](word_t g) const
+  {
+    assert(g < size());
+    switch (width_) {
+      case 1: return static_cast<const uint8_t*>(data_)[g];
+      case 2: return static_cast<const uint16_t*>(data_)[g];
+      default: return static_cast<const uint32_t*>(data_)[g];
+    }
+  }
+
+  // Look up n genotypes at once. A table that fits in cache takes a plain
+  // indexed load per lookup, which the compiler can vectorize; a wider one
+  // has its entries prefetched some lookups ahead, so that the cache misses
+  // overlap instead of serializing.
+  void lookup(const word_t* __restrict g, phenotype_t* __restrict out, size_t n) const
+  {
+    switch (width_) {
+      case 1: lookup_as<uint8_t>(g, out, n); break;
+      case 2: lookup_as<uint16_t>(g, out, n); break;
+      default: lookup_as<uint32_t>(g, out, n); break;
+    }
+  }
+
+  // The first genotype that maps to value p, or size() if none does. This
+  // scans the whole table, so it's meant for setting up, not for searching.
+  word_t encode(phenotype_t p) const
+  {
+    switch (width_) {
+      case 1: return encode_as<uint8_t>(p);
+      case 2: return encode_as<uint16_t>(p);
+      default: return encode_as<uint32_t>(p);
+    }
+  }
+
+  // The largest value in the table. This reads the whole table, e.g., 64 MiB
+  // at 24 bits (some milliseconds from the page cache, but the time to read
+  // it from disk otherwise):
+  phenotype_t max() const
+  {
+    switch (width_) {
+      case 1: return max_as<uint8_t>();
+      case 2: return max_as<uint16_t>();
+      default: return max_as<uint32_t>();
+    }
+  }
+
+ private:
+  static constexpr size_t PREFETCH_AHEAD = 16;
+  static constexpr size_t CACHED_BYTES = size_t(256) << 10;  // About L2 size
+
+  template <class Entry>
+  void lookup_as(const word_t* __restrict g, phenotype_t* __restrict out, size_t n) const
+  {
+    const Entry* table = static_cast<const Entry*>(data_);
+    if (bytes() <= CACHED_BYTES) {
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = table[g[i]];
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < std::min(n, PREFETCH_AHEAD); ++i) {
+      __builtin_prefetch(table + g[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if (i + PREFETCH_AHEAD < n) {
+        __builtin_prefetch(table + g[i + PREFETCH_AHEAD]);
+      }
+      out[i] = table[g[i]];
+    }
+  }
+
+  template <class Entry>
+  word_t encode_as(phenotype_t p) const
+  {
+    const Entry* table = static_cast<const Entry*>(data_);
+    return std::find(table, table + size(), p) - table;
+  }
+
+  template <class Entry>
+  phenotype_t max_as() const
+  {
+    const Entry* table = static_cast<const Entry*>(data_);
+    return *std::max_element(table, table + size());
+  }
+
+  // Allocate the table's own memory. With huge_pages, try explicit huge pages
+  // first, and fall back to asking for transparent ones.
+  void* allocate(bool huge_pages)
+  {
+    owned_size_ = huge_pages? (bytes() + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE : bytes();
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    owned_ = MAP_FAILED;
+    if (huge_pages) {
+      owned_ = mmap(nullptr, owned_size_, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    }
+    if (owned_ == MAP_FAILED) {
+      owned_ = mmap(nullptr, owned_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+      if (owned_ == MAP_FAILED) {
+        std::cerr << "Can't allocate a table of " << bytes() << " bytes\n";
+        exit(1);
+      }
+      if (huge_pages) {
+        madvise(owned_, owned_size_, MADV_HUGEPAGE);
+      }
+    }
+    data_ = owned_;
+    return owned_;
+  }
+
+  const void* data_;
+  const size_t len_, width_;  // Genotype bits, and bytes per entry
+  void* owned_;               // The mapping of an owned table, if any
+  size_t owned_size_;
+};
+
+// Representation from an explicit mapping of bits to values:
 phenotype_t
-explicit_rep(const bits_t& bits, const std::vector<phenotype_t>& mapping)
+explicit_rep(const bits_t& bits, const explicit_table_t& table)
 {
-  const phenotype_t loc = std_binary_rep(bits);
-  return mapping[loc];
+  return table[std_binary_rep(bits)];
 }
 
 // A few example mappings for len=3 bits (assume a=4)
@@ -246,126 +683,2394 @@ const std::vector<phenotype_t> five_ngg =
   { 0, 1, 19, 2, 31, 28, 20, 3, 23, 26, 24, 25, 22, 27, 21, 4,
     13, 14, 18, 15, 30, 29, 17, 16,12, 9, 11, 10, 7, 8, 6, 5 };
 
-/////////////////////////////////////////////////////////////////////////////
-// Fitness functions for the one-max problem: given an 'a' value and a
-// representation, compute the phenotypical value of the input bits given the
-// representation, and calculate a linear scaling fitness that maximizes at
-// the 'a' value.
-double
-onemax(const phenotype_t a, const rep_t& rep, const bits_t& bits)
-{
-  const auto phenotype = rep(bits);
-  const auto maxfit = (1 << bits.size()) - 1;
-  assert(double(a) <= maxfit);
-  return maxfit - abs(double(phenotype) - a);
-}
-
-double
-count_ones(const phenotype_t, const rep_t&, const bits_t& bits)
-{
-  return std::accumulate(bits.cbegin(), bits.cend(), 0);
-}
+// All the explicit mappings above, by their command-line names:
+const std::map<std::string, const std::vector<phenotype_t>*> explicit_mappings = {
+  { "one_maxima", &one_maxima },
+  { "two_maxima", &two_maxima },
+  { "three_maxima", &three_maxima },
+  { "four_maxima", &four_maxima },
+  { "different_four_maxima", &different_four_maxima },
+  { "worst", &five_worst },
+  { "ubl", &five_ubl },
+  { "ngg", &five_ngg },
+};
 
-/////////////////////////////////////////////////////////////////////////////
-void usage()
-{
-  std::cerr << "Try running with the following integer arguments: a p g e\n";
-  std::cerr << "a:\tThe binary value to strive to (default: 31)\n";
-  std::cerr << "p:\tPopulation size, how many bitstrings are concatenated\n";
-  std::cerr << "g:\tNumber of generations (fitness evaluations) to run for\n";
-  std::cerr << "e:\tNumber of experiments to run concurrently\n";
-}
+// A library of explicit mappings of the same length, from a file, to run
+// them all in one process. The file is either binary: the magic string
+// "REPLIB01", the length and the number of mappings as native 32-bit
+// values, and then the mappings, each a table of 2^length native entries of
+// explicit_table_t::entry_size(length) bytes; or text: a mapping per line,
+// as values separated by whitespace, optionally preceded by a name and a
+// colon (as locality.cc prints representations). Lines that start with '#'
+// are comments. Either way, the file is memory-mapped, and binary mappings
+// are used in place, read on demand (but see checked()).
+class mapping_library_t {
+ public:
+  static constexpr char MAGIC[8] = { 'R', 'E', 'P', 'L', 'I', 'B', '0', '1' };
 
-/////////////////////////////////////////////////////////////////////////////
-// Simulation main loop
-// First, simulation parameters are chosen, including which representation
-// to interpret the bit-string with.
-// Algorithm: Loop over number of generations. In each generation, mutate
-// each organism (there are 'experiments' of them), and decide whether to use
-// the mutated offspring instead of the parent organism for the next gen.
-// The decisions on how to mutate and when to replace a parent are based on
-// the specific GEA chosen (SA / ES).
-// Results are saved per generation, aggregated over all experiments, and
-// reported on a generation-by-generation basis.
-//
-int main(int argc, char* argv[])
-{
-  const size_t len = 5;  // How many bits per organism?
-  int a = (1 << len) - 1;   // Value to maximize to
-  int popsize = 1;    // How many organisms per SA?
-  unsigned generations = 2000; // How many fitness evaluations to run for?
-  unsigned experiments = 100000;  // How many different SAs to average over?
+  explicit mapping_library_t(const std::string& fname)
+  : map_(nullptr), map_size_(0), values_(nullptr), owned_(), names_(), len_(0), count_(0)
+  {
+    const int fd = open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      std::cerr << "Can't read " << fname << "\n";
+      exit(1);
+    }
+    map_size_ = st.st_size;
+    if (map_size_ > 0) {
+      map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map_ == MAP_FAILED || map_ == nullptr) {
+      std::cerr << "Can't map " << fname << "\n";
+      exit(1);
+    }
 
-  if (argc == 1) {
-    usage();
+    const char* data = static_cast<const char*>(map_);
+    const size_t header = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+    if (map_size_ >= header && !memcmp(data, MAGIC, sizeof(MAGIC))) {
+      const auto fields = reinterpret_cast<const uint32_t*>(data + sizeof(MAGIC));
+      len_ = fields[0];
+      count_ = fields[1];
+      values_ = data + header;
+      // By division, so that no count or length can overflow the product:
+      if (len_ >= 32
+          || count_ > (map_size_ - header) / (explicit_table_t::entry_size(len_) << len_)) {
+        std::cerr << fname << " is truncated\n";
+        exit(1);
+      }
+      madvise(map_, map_size_, MADV_WILLNEED);
+    } else {
+      parse_text(fname, data, data + map_size_);
+    }
+    names_.resize(count_);
+    for (size_t i = 0; i < count_; ++i) {
+      if (names_[i].empty()) {
+        names_[i] = std::to_string(i);
+      }
+    }
   }
-  if (argc > 1) {
-    a = atoi(argv[1]);
+
+  mapping_library_t(const mapping_library_t&) = delete;
+  mapping_library_t& operator=(const mapping_library_t&) = delete;
+
+  ~mapping_library_t()
+  {
+    if (map_) {
+      munmap(map_, map_size_);
+    }
   }
-  if (argc > 2) {
-    popsize = atoi(argv[2]);
+
+  size_t len() const { return len_; }
+  size_t size() const { return count_; }
+  const std::string& name(size_t i) const { return names_[i]; }
+
+  // Whether all values are known to be of at most len bits, without reading
+  // the tables: text mappings are checked as they're parsed, and entries of
+  // exactly len bits can't hold more. Otherwise, a binary mapping's values
+  // must be checked with explicit_table_t::max(), which reads it all.
+  bool checked() const
+  {
+    return values_ == owned_.data() || explicit_table_t::entry_size(len_) * 8 == len_;
   }
-  if (argc > 3) {
-    generations = atoi(argv[3]);
+
+  // A view of mapping i, valid as long as the library:
+  explicit_table_t mapping(size_t i) const
+  {
+    return explicit_table_t(values_ + (i * explicit_table_t::entry_size(len_) << len_), len_);
   }
-  if (argc > 4) {
-    experiments = atoi(argv[4]);
+
+ private:
+  void parse_text(const std::string& fname, const char* p, const char* end)
+  {
+    std::vector<uint64_t> line;
+    std::vector<uint32_t> values;
+    while (p < end) {
+      const char* eol = std::find(p, end, '\n');
+      const char* first = p;
+      while (first < eol && (*first == ' ' || *first == '\t')) {
+        ++first;
+      }
+      if (first == eol || *first == '#') {
+        p = eol + 1;
+        continue;
+      }
+      std::string name;
+      const char* colon = std::find(p, eol, ':');
+      if (colon != eol) {
+        name.assign(p, colon);
+        name.erase(0, name.find_first_not_of(" \t"));
+        p = colon + 1;
+      }
+      line.clear();
+      uint64_t value = 0;
+      bool in_number = false;
+      for (; p < eol; ++p) {
+        if (*p >= '0' && *p <= '9') {
+          // Past 32 bits, a value is out of range anyway, so stop there
+          // rather than wrap around:
+          value = value >> 32? value : value * 10 + (*p - '0');
+          in_number = true;
+        } else if (in_number) {
+          line.push_back(value);
+          value = 0;
+          in_number = false;
+        }
+      }
+      if (in_number) {
+        line.push_back(value);
+      }
+      p = eol + 1;
+      if (line.empty()) {
+        continue;
+      }
+
+      if (!count_) {
+        while ((size_t(1) << len_) < line.size()) {
+          ++len_;
+        }
+      }
+      if (line.size() != (size_t(1) << len_)) {
+        std::cerr << fname << ": mapping " << count_ << " doesn't have 2^" << len_ << " entries\n";
+        exit(1);
+      }
+      if (*std::max_element(line.cbegin(), line.cend()) >> len_) {
+        std::cerr << fname << ": mapping " << count_ << " has values of more than " << len_ << " bits\n";
+        exit(1);
+      }
+      values.insert(values.end(), line.begin(), line.end());
+      names_.push_back(name);
+      ++count_;
+    }
+
+    // Store the values as tables of the narrowest entries:
+    const size_t width = explicit_table_t::entry_size(len_);
+    owned_.resize(values.size() * width);
+    for (size_t i = 0; i < values.size(); ++i) {
+      memcpy(&owned_[i * width], &values[i], width);  // Little endian
+    }
+    values_ = owned_.data();
   }
 
-  //const auto rep = [](const bits_t& bits){ return explicit_rep(bits, five_ngg); };
-  //const auto rep = [](const bits_t& bits){ return explicit_rep(bits, five_ubl); };
-  //const auto rep = [](const bits_t& bits){ return brg_rep(bits); };
-  const auto rep = [](const bits_t& bits){ return std_binary_rep(bits); };
+  void* map_;
+  size_t map_size_;
+  const char* values_;              // All the tables, one after the other
+  std::vector<char> owned_;         // The tables, if parsed from text
+  std::vector<std::string> names_;
+  size_t len_, count_;
+};
 
-  const auto fit = [=](const bits_t& bits) { return onemax(a, rep, bits); };
-  const auto maxfit = (1 << len) - 1;
-  //const auto fit = [=](const bits_t& bits) { return count_ones(a, rep, bits); };
-  //const auto maxfit = len;
+// Representation policies: function objects wrapping the encodings above.
+// flip(p, bits, idx) returns the phenotype of 'bits', given that it differs
+// from a genotype with phenotype 'p' only in bit 'idx'.
+// decode(word) decodes a genotype of up to 63 bits given as a packed word,
+// and decode(g, p, n) decodes the n packed genotypes at g into p, as one
+// loop that the compiler can vectorize. encode(p) is the inverse of decode:
+// a genotype that decodes to p, or if none of len bits does, one of more.
+//
+// Packed words are in the same order as bits_t's words, most significant
+// bit first, so the standard binary decoder is the identity, with no bit
+// reversal.
+struct StdBinaryRep {
+  using word_t = bits_t::word_t;
 
-  std::vector<Sim> sims;
-  std::vector<unsigned> gens(experiments, generations);
+  phenotype_t operator()(const bits_t& bits) const { return std_binary_rep(bits); }
+  phenotype_t decode(word_t word) const { return word; }
+  void decode(const word_t* g, phenotype_t* p, size_t n) const { std::copy(g, g + n, p); }
+  word_t encode(phenotype_t p) const { return p; }
 
-  assert(len > 0);
-  for(size_t i = 0; i < experiments; ++i) {
-    sims.push_back(Sim(popsize, len, fit, 1. / len));
+  // Flipping a bit adds or subtracts its place value:
+  phenotype_t flip(phenotype_t p, const bits_t& bits, size_t idx) const
+  {
+    return p ^ (phenotype_t(1) << (bits.size() - 1 - idx));
   }
+};
 
+struct BrgRep {
+  using word_t = bits_t::word_t;
 
-  std::cout << "# Generation\tratio_optimal\tmean_fitness\n";
+  phenotype_t operator()(const bits_t& bits) const { return brg_rep(bits); }
+  phenotype_t decode(word_t word) const { return brg_decode(word); }
+  word_t encode(phenotype_t p) const { return brg_encode(p); }
 
-  // Main loops: generations and experiments
-  for (unsigned g = 1; g <= generations; ++g) {
-    std::atomic<unsigned> opt_count = 0;
-    std::atomic<uint64_t> sum_fitness = 0;
+  // The prefix-XOR steps of all the words at once, in vector lanes:
+  void decode(const word_t* __restrict g, phenotype_t* __restrict p, size_t n) const
+  {
+    for (size_t i = 0; i < n; ++i) {
+      p[i] = brg_decode(g[i]);
+    }
+  }
 
-    parallel_for(size_t(0), sims.size(), [&](size_t i) {
-      opt_count += sims[i].num_optimal(maxfit);
-      sum_fitness += sims[i].fitness();
-      if (sims[i].fitness() == maxfit && g < gens[i]) {
-        gens[i] = g;
-      }
-      sims[i].ES_generation();
-    });
+  // Flipping a gray bit flips the binary bit in its place and all the ones below:
+  phenotype_t flip(phenotype_t p, const bits_t& bits, size_t idx) const
+  {
+    return p ^ ((phenotype_t(2) << (bits.size() - 1 - idx)) - 1);
+  }
+};
 
-/* Sequential version of inner loop, if TBB is missing:
-     for (auto& sim : sims) {
-       opt_count += sim.num_optimal(maxfit);
-      sum_fitness += sim.fitness();
-       sim.generation();
-     }
-*/
+struct ExplicitRep {
+  using word_t = bits_t::word_t;
 
-    std::cout << g << "\t";
-    std::cout << double(opt_count) / (experiments * popsize) << "\t";
-    std::cout << double(sum_fitness) / (experiments * popsize) << "\n";
-  }
+  const explicit_table_t* table;
+  phenotype_t operator()(const bits_t& bits) const { return explicit_rep(bits, *table); }
+  phenotype_t decode(word_t word) const { return (*table)[word]; }
+  void decode(const word_t* g, phenotype_t* p, size_t n) const { table->lookup(g, p, n); }
+  word_t encode(phenotype_t p) const { return table->encode(p); }
 
-  std::vector<unsigned> completed;
-  std::copy_if(gens.cbegin(), gens.cend(), std::back_inserter(completed),
-      [generations](unsigned g){ return g < generations; });
+  // An arbitrary mapping has no structure to exploit, so just look it up:
+  phenotype_t flip(phenotype_t, const bits_t& bits, size_t) const { return (*this)(bits); }
+};
 
-  std::cerr << "Mean generation to optimal solution: ";
-  std::cerr << std::accumulate(completed.cbegin(), completed.cend(), 0) / double(completed.size());
-  std::cerr << std::endl;
+/////////////////////////////////////////////////////////////////////////////
+// Fitness functions for the one-max problem: given an 'a' value and a
+// representation, compute the phenotypical value of the input bits given the
+// representation, and calculate a linear scaling fitness that maximizes at
+// the 'a' value.
+double
+onemax_fitness(const phenotype_t a, const phenotype_t phenotype, size_t len)
+{
+  const auto maxfit = (phenotype_t(1) << len) - 1;
+  return maxfit - std::abs(double(phenotype) - a);
+}
+
+template <class Rep>
+double
+onemax(const phenotype_t a, const Rep& rep, const bits_t& bits)
+{
+  assert(a < (phenotype_t(1) << bits.size()));
+  return onemax_fitness(a, rep(bits), bits.size());
+}
+
+template <class Rep>
+double
+count_ones(const phenotype_t, const Rep&, const bits_t& bits)
+{
+  return bits.count();
+}
+
+// Fitness policies: function objects wrapping the fitness functions above,
+// that also know the optimal fitness for a given genotype length.
+// For incremental evaluation, the fitness is split into two steps:
+// phenotype() maps the bits to the value the fitness depends on, and score()
+// maps that value to a fitness. flip() updates the value after a single-bit
+// flip without decoding the whole genotype, where possible. decode() is
+// phenotype() for genotypes packed in single words, one or many at a time,
+// and encode() is its inverse, as for the representation policies.
+template <class Rep>
+struct OneMax {
+  phenotype_t a;
+  Rep rep;
+
+  double operator()(const bits_t& bits) const { return onemax(a, rep, bits); }
+  double optimum(size_t len) const { return (phenotype_t(1) << len) - 1; }
+
+  phenotype_t phenotype(const bits_t& bits) const { return rep(bits); }
+  phenotype_t decode(bits_t::word_t word) const { return rep.decode(word); }
+  void decode(const bits_t::word_t* g, phenotype_t* p, size_t n) const { rep.decode(g, p, n); }
+  bits_t::word_t encode(phenotype_t p) const { return rep.encode(p); }
+  phenotype_t flip(phenotype_t p, const bits_t& bits, size_t idx) const { return rep.flip(p, bits, idx); }
+  double score(phenotype_t p, size_t len) const { return onemax_fitness(a, p, len); }
+};
+
+// For count_ones, the tracked value is simply the number of ones:
+template <class Rep>
+struct CountOnes {
+  phenotype_t a;
+  Rep rep;
+
+  double operator()(const bits_t& bits) const { return count_ones(a, rep, bits); }
+  double optimum(size_t len) const { return len; }
+
+  phenotype_t phenotype(const bits_t& bits) const { return bits.count(); }
+  phenotype_t decode(bits_t::word_t word) const { return __builtin_popcountll(word); }
+  phenotype_t flip(phenotype_t p, const bits_t& bits, size_t idx) const { return bits[idx]? p + 1 : p - 1; }
+
+  void decode(const bits_t::word_t* __restrict g, phenotype_t* __restrict p, size_t n) const
+  {
+    for (size_t i = 0; i < n; ++i) {
+      p[i] = __builtin_popcountll(g[i]);
+    }
+  }
+
+  // The genotype with the p lowest bits set:
+  bits_t::word_t encode(phenotype_t p) const
+  {
+    return p < bits_t::WORD_BITS? (bits_t::word_t(1) << p) - 1 : ~bits_t::word_t(0);
+  }
+  double score(phenotype_t p, size_t) const { return p; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// A fitness table holds the phenotype and fitness of every genotype of a
+// given length, indexed by the genotype's packed word. For short genotypes,
+// the table fits in cache and is shared by all the experiments of a run, so
+// evaluating any representation and fitness function becomes a single
+// indexed load. It takes 16 bytes per genotype, hence the MAX_BITS limit.
+struct fitness_table_t {
+  static constexpr size_t MAX_BITS = 24;
+
+  std::vector<phenotype_t> phenotype;
+  std::vector<double> fitness;
+  double optimum;
+};
+
+template <class Fitness>
+fitness_table_t
+make_fitness_table(const Fitness& fit, size_t len)
+{
+  assert(len <= fitness_table_t::MAX_BITS);
+  const size_t n = size_t(1) << len;
+  fitness_table_t ret { std::vector<phenotype_t>(n), std::vector<double>(n), fit.optimum(len) };
+
+  parallel_for(size_t(0), n, [&](size_t g) {
+    bits_t bits(len);
+    bits.words()[0] = g;
+    ret.phenotype[g] = fit.phenotype(bits);
+    ret.fitness[g] = fit.score(ret.phenotype[g], len);
+  });
+  return ret;
+}
+
+// Fitness policy over a fitness table: the tracked value is the genotype
+// itself, so a single-bit flip is one xor and the fitness one load.
+struct TabulatedFitness {
+  const fitness_table_t* table;
+
+  double operator()(const bits_t& bits) const { return table->fitness[bits.to_word()]; }
+  double optimum(size_t) const { return table->optimum; }
+
+  phenotype_t phenotype(const bits_t& bits) const { return bits.to_word(); }
+  phenotype_t decode(bits_t::word_t word) const { return word; }
+  void decode(const bits_t::word_t* g, phenotype_t* p, size_t n) const { std::copy(g, g + n, p); }
+  phenotype_t flip(phenotype_t g, const bits_t& bits, size_t idx) const
+  {
+    return g ^ (phenotype_t(1) << (bits.size() - 1 - idx));
+  }
+  double score(phenotype_t g, size_t) const { return table->fitness[g]; }
+
+  // The genotype whose phenotype, in the tabulated fitness function, is p:
+  bits_t::word_t encode(phenotype_t p) const
+  {
+    const auto& ph = table->phenotype;
+    return std::find(ph.cbegin(), ph.cend(), p) - ph.cbegin();
+  }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// All the simulation parameters, as chosen on the command line:
+struct config_t {
+  size_t len = 5;                 // How many bits per organism?
+  phenotype_t a = (1 << len) - 1; // Value to maximize to
+  unsigned popsize = 1;           // How many organisms per SA?
+  unsigned generations = 2000;    // How many fitness evaluations to run for?
+  unsigned experiments = 100000;  // How many different SAs to average over?
+  double temp = 50;               // Initial SA temperature
+  double tadj = 0.995;            // SA temperature adjustment per generation
+  algorithm_t algorithm = algorithm_t::ES;
+  mutation_t mutation = mutation_t::BITWISE;
+  std::string rep = "sb";         // Representation name
+  std::string fitness = "onemax"; // Fitness function name
+  std::string engine = "object";  // How to lay out and run the experiments
+  bool table = false;             // Evaluate fitness from a precomputed table?
+  uint64_t seed = std::random_device()();  // Master random seed
+  size_t tile = 0;                // Experiments per tile (0: no tiling)
+  bool stop = false;              // Stop once all ES experiments are solved?
+  std::string fpt_file;           // Where to write the first-passage distribution
+  bool hitting = false;           // Compute expected hitting times instead?
+  std::string library;            // Run all the mappings in this library file
+  bool huge_pages = false;        // Copy explicit mapping tables to huge pages?
+  int64_t start = -1;             // Phenotype to start all organisms at (-1: random)
+};
+
+// The genotype to start all organisms at, as the fitness policy encodes
+// cfg.start, packed in a word:
+template <class Fitness>
+bits_t::word_t
+start_genotype(const config_t& cfg, const Fitness& fit)
+{
+  assert(cfg.start >= 0 && cfg.len < bits_t::WORD_BITS);
+  const auto ret = fit.encode(cfg.start);
+  if (ret >> cfg.len) {
+    std::cerr << "No genotype of " << cfg.len << " bits has phenotype " << cfg.start << "\n";
+    exit(1);
+  }
+  return ret;
+}
+
+// Statistics of the organisms of all experiments at one generation. They
+// are sums and extremes, so the statistics of disjoint groups of organisms
+// merge with +=, in any order: every task or thread accumulates its own, and
+// nothing is shared until they're combined. For integral fitness values (up
+// to 2^53) the sums are exact.
+struct gen_stats_t {
+  uint64_t count = 0;     // How many organisms
+  double optimal = 0;     // How many organisms are optimal (or are expected
+                          // to be, in the exact engine)
+  double fitness = 0;     // Sum of all organisms' fitness
+  double sumsq = 0;       // Sum of the squares of their fitness
+  double min = INFINITY;  // Lowest and highest fitness
+  double max = -INFINITY;
+
+  // Add n organisms of fitness f, of which opt are optimal:
+  void add(double f, double opt = 0, uint64_t n = 1)
+  {
+    count += n;
+    optimal += opt;
+    fitness += n * f;
+    sumsq += n * f * f;
+    min = std::min(min, f);
+    max = std::max(max, f);
+  }
+
+  gen_stats_t& operator+=(const gen_stats_t& other)
+  {
+    count += other.count;
+    optimal += other.optimal;
+    fitness += other.fitness;
+    sumsq += other.sumsq;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    return *this;
+  }
+
+  double mean() const { return fitness / count; }
+
+  // Sample variance of the fitness:
+  double variance() const
+  {
+    return count > 1? std::max(0., (sumsq - fitness * mean()) / (count - 1)) : 0;
+  }
+
+  // Half-width of the 95% confidence interval of the mean fitness (normal
+  // approximation):
+  double ci95() const { return 1.96 * std::sqrt(variance() / count); }
+};
+
+// Collect the statistics body(first, last) of all units [0, n) of an engine
+// (see below), with unit_size experiments per unit, in parallel: each task
+// sums a range of about REDUCE_GRAIN experiments on its own, and the partial
+// sums are merged pairwise. The split points don't depend on scheduling, so
+// the result is the same from run to run.
+constexpr size_t REDUCE_GRAIN = 1024;
+
+template <class Body>
+gen_stats_t
+reduce_stats(size_t n, size_t unit_size, const Body& body)
+{
+  const auto grain = std::max<size_t>(1, REDUCE_GRAIN / unit_size);
+  return parallel_deterministic_reduce(blocked_range<size_t>(0, n, grain), gen_stats_t(),
+      [&](const blocked_range<size_t>& r, gen_stats_t acc) {
+        acc += body(r.begin(), r.end());
+        return acc;
+      },
+      [](gen_stats_t lhs, const gen_stats_t& rhs) { return lhs += rhs; });
+}
+
+// The SA temperature at each generation, for engines that run one cooling
+// schedule for all experiments. It's computed by repeated multiplication,
+// exactly as Sim does, and tabulated so that experiments can be at
+// different generations at the same time (see run_tiled()).
+class cooling_schedule_t {
+ public:
+  cooling_schedule_t(const config_t& cfg) : temps_(cfg.generations + 1)
+  {
+    double temp = cfg.temp;
+    for (size_t g = 1; g < temps_.size(); ++g) {
+      temps_[g] = temp;
+      temp *= cfg.tadj;
+    }
+  }
+
+  double temp(unsigned g) const { return temps_[g]; }
+
+  // Fill table[d] with the Boltzmann acceptance probability exp(-d / T) of
+  // a fitness loss d at generation g:
+  void boltzmann(unsigned g, std::vector<double>& table) const
+  {
+    for (size_t d = 0; d < table.size(); ++d) {
+      table[d] = exp(-double(d) / temps_[g]);
+    }
+  }
+
+ private:
+  std::vector<double> temps_;
+};
+
+// The SA acceptance probability exp(-d / T) of a fitness loss d at one
+// generation: looked up in the generation's table, when all experiments are
+// at the same generation and share one, or computed on the spot in tiled
+// execution, where each tile is at a generation of its own, and a table per
+// tile and generation would take more exp() calls than the tile has moves.
+struct acceptance_t {
+  const double* table;  // The generation's Boltzmann table, or nullptr
+  double temp;
+
+  double operator()(size_t d) const { return table? table[d] : exp(-double(d) / temp); }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Engines run all the experiments of a simulation. Each engine has a
+// generation(g) method that collects the statistics of all experiments at
+// the start of generation g and then runs the generation, and a solved_at()
+// method returning, per experiment, the first generation it was found solved
+// (or the total number of generations if it never was).
+// For tiled execution, the experiments are grouped in size() units of
+// unit_size() experiments each (a Sim, or a block of lanes), which are
+// independent of each other: run_generation(first, last, g) does the work of
+// generation(g) for units [first, last) only, sequentially, and returns
+// their statistics. Generations of a unit must still run in order.
+
+// The object engine: a vector of Sim objects, one per experiment.
+template <class Fitness, algorithm_t ALG>
+class SimEngine {
+ public:
+  SimEngine(const config_t& cfg, const Fitness& fit)
+  : sims_(), gens_(cfg.experiments, cfg.generations), active_(cfg.experiments), retired_()
+  {
+    assert(cfg.len > 0);
+    for(size_t i = 0; i < cfg.experiments; ++i) {
+      sims_.push_back(Sim<Fitness, ALG>(cfg.popsize, cfg.len, fit, 1. / cfg.len,
+                                        cfg.mutation, rng_t::stream(cfg.seed, i),
+                                        cfg.temp, cfg.tadj));
+    }
+    if (cfg.start >= 0) {
+      const auto g = start_genotype(cfg, fit);
+      for (auto& sim : sims_) {
+        sim.start_at(g);
+      }
+    }
+    std::iota(active_.begin(), active_.end(), 0);
+  }
+
+  gen_stats_t generation(unsigned g)
+  {
+    auto ret = reduce_stats(active_.size(), unit_size(), [&](size_t first, size_t last) {
+      gen_stats_t acc;
+      for (size_t k = first; k < last; ++k) {
+        add_stats(acc, active_[k], g);
+      }
+      return acc;
+    });
+    ret += retired_;
+
+    if constexpr (ALG == algorithm_t::ES) {
+      retire(g);
+    }
+    parallel_for(size_t(0), active_.size(), [&](size_t k) { sims_[active_[k]].generation(); });
+    return ret;
+  }
+
+  size_t size() const { return sims_.size(); }
+  size_t unit_size() const { return 1; }
+
+  // Tiles don't compact their Sims, but skip the absorbed ones.
+  gen_stats_t run_generation(size_t first, size_t last, unsigned g)
+  {
+    gen_stats_t ret;
+    for (size_t i = first; i < last; ++i) {
+      add_stats(ret, i, g);
+    }
+    for (size_t i = first; i < last; ++i) {
+      if (!absorbed(i)) {
+        sims_[i].generation();
+      }
+    }
+    return ret;
+  }
+
+  const std::vector<unsigned>& solved_at() const { return gens_; }
+
+ private:
+  // Add the statistics of Sim i to stats, and record it if newly solved.
+  // (Kept out of the loops that run the Sims: mixing the two there makes
+  // the compiler leave wide vector registers dirty across the calls to exp()
+  // in SA, which slows them down severalfold.)
+  void add_stats(gen_stats_t& stats, size_t i, unsigned g)
+  {
+    for (size_t u = 0; u < sims_[i].size(); ++u) {
+      stats.add(sims_[i].fitness(u));
+    }
+    stats.optimal += sims_[i].num_optimal();
+    if (sims_[i].solved() && g < gens_[i]) {
+      gens_[i] = g;
+    }
+  }
+
+  // In ES, only strictly fitter offspring are accepted, so once all of an
+  // experiment's organisms are optimal it can never change again:
+  bool absorbed(size_t i) const { return ALG == algorithm_t::ES && sims_[i].solved(); }
+
+  // Move the absorbed experiments out of the active set, keeping the rest
+  // in order, and add their (now constant) statistics to retired_:
+  void retire(unsigned g)
+  {
+    const auto last = std::remove_if(active_.begin(), active_.end(), [&](size_t i) {
+      if (absorbed(i)) {
+        add_stats(retired_, i, g);
+        return true;
+      }
+      return false;
+    });
+    active_.erase(last, active_.end());
+  }
+
+  std::vector<Sim<Fitness, ALG>> sims_;
+  std::vector<unsigned> gens_;
+  std::vector<size_t> active_;  // The experiments that generation() runs
+  gen_stats_t retired_;         // Statistics of all the other experiments
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// What the batch and bit-sliced engines share: both advance their
+// experiments a block of Engine::LANES at a time, with Engine's
+// block_stats_at(b, g), SA_block(b, acceptance) and ES_block(b). For a whole
+// generation, SA's acceptance probabilities are looked up from a Boltzmann
+// table filled once per generation, indexed by the (integral) fitness loss,
+// so SA needs a small integral optimum (MAX_OPTIMUM); within a tile
+// (run_generation()), which only runs a few blocks per generation, they're
+// computed as needed instead.
+template <class Engine, algorithm_t ALG>
+class BlockEngine {
+ public:
+  static constexpr double MAX_OPTIMUM = 1 << 16;
+
+  gen_stats_t generation(unsigned g)
+  {
+    if constexpr (ALG == algorithm_t::SA) {
+      schedule_.boltzmann(g, boltzmann_);
+    }
+
+    const acceptance_t acceptance { boltzmann_.data(), schedule_.temp(g) };
+    return reduce_stats(engine().size(), Engine::LANES, [&](size_t first, size_t last) {
+      return run_blocks(first, last, g, acceptance);
+    });
+  }
+
+  gen_stats_t run_generation(size_t first, size_t last, unsigned g)
+  {
+    return run_blocks(first, last, g, { nullptr, schedule_.temp(g) });
+  }
+
+ protected:
+  // optimum is the size of the Boltzmann table, less one:
+  BlockEngine(const config_t& cfg, double optimum)
+  : schedule_(cfg), boltzmann_(ALG == algorithm_t::SA? size_t(optimum) + 1 : 0)
+  {
+  }
+
+ private:
+  Engine& engine() { return static_cast<Engine&>(*this); }
+
+  gen_stats_t run_blocks(size_t first, size_t last, unsigned g, const acceptance_t& acceptance)
+  {
+    gen_stats_t ret;
+    for (size_t b = first; b < last; ++b) {
+      ret += step_block(b, g, acceptance);
+    }
+    return ret;
+  }
+
+  // Collect the statistics of block b at the start of generation g, then
+  // run the generation, with SA acceptance probabilities from acceptance.
+  // An ES block whose organisms are all optimal can never change again, so
+  // it's skipped.
+  gen_stats_t step_block(size_t b, unsigned g, const acceptance_t& acceptance)
+  {
+    const auto ret = engine().block_stats_at(b, g);
+    if constexpr (ALG == algorithm_t::SA) {
+      engine().SA_block(b, acceptance);
+    } else if (ret.optimal < ret.count) {
+      engine().ES_block(b);
+    }
+    return ret;
+  }
+
+  const cooling_schedule_t schedule_;
+  std::vector<double> boltzmann_;  // This generation's acceptance table (SA)
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// The batch engine runs the same algorithms as Sim, but keeps the state of
+// all experiments in contiguous arrays (structure of arrays): LANES
+// experiments make up a block, and each block is advanced with lane-by-lane
+// loops over fixed-size arrays, which the compiler vectorizes (with
+// -march=native, 8-16 experiments per AVX2/AVX-512 instruction). Genotypes
+// are single words, so decoding an explicit mapping is a gather.
+// Each experiment draws from its own xoshiro256** stream, seeded as the
+// equivalent Sim would be, but consumes it differently, so the two engines
+// agree statistically, not bit for bit.
+// SA on the batch engine requires a small integral optimum (see
+// BlockEngine); ES has no such limit.
+template <class Fitness, algorithm_t ALG>
+class BatchEngine : public BlockEngine<BatchEngine<Fitness, ALG>, ALG> {
+ public:
+  static constexpr size_t LANES = 16;
+  using word_t = bits_t::word_t;
+
+  BatchEngine(const config_t& cfg, const Fitness& fit)
+  : BlockEngine<BatchEngine, ALG>(cfg, fit.optimum(cfg.len))
+  , fit_(fit), len_(cfg.len), units_(cfg.popsize), experiments_(cfg.experiments)
+  , nblocks_((experiments_ + LANES - 1) / LANES), optimum_(fit.optimum(len_)), p_m_(1. / len_)
+  , rng_(nblocks_), geno_(nblocks_ * units_ * LANES), fitness_(geno_.size()), bit_masks_(len_)
+  , gens_(experiments_, cfg.generations)
+  {
+    assert(len_ > 0 && len_ < bits_t::WORD_BITS);
+    assert(ALG == algorithm_t::ES || optimum_ <= BatchEngine::MAX_OPTIMUM);
+
+    for (size_t i = 0; i < len_; ++i) {
+      bit_masks_[i] = word_t(1) << i;
+    }
+
+    const word_t mask = (word_t(1) << len_) - 1;
+    const bool start = cfg.start >= 0;
+    const word_t g0 = start? start_genotype(cfg, fit) : 0;
+    for (size_t b = 0; b < nblocks_; ++b) {
+      for (size_t l = 0; l < LANES; ++l) {
+        const auto s = rng_t::stream(cfg.seed, b * LANES + l).state();
+        rng_[b].s0[l] = s[0];
+        rng_[b].s1[l] = s[1];
+        rng_[b].s2[l] = s[2];
+        rng_[b].s3[l] = s[3];
+      }
+      for (size_t u = 0; u < units_; ++u) {
+        alignas(64) word_t r[LANES];
+        rng_[b].next(r);
+        for (size_t l = 0; l < LANES; ++l) {
+          r[l] = start? g0 : r[l] & mask;
+        }
+        std::copy(r, r + LANES, &geno_[idx(b, u, 0)]);
+        evaluate(r, &fitness_[idx(b, u, 0)]);
+      }
+    }
+  }
+
+  size_t size() const { return nblocks_; }
+  size_t unit_size() const { return LANES; }
+
+  const std::vector<unsigned>& solved_at() const { return gens_; }
+
+ private:
+  friend class BlockEngine<BatchEngine, ALG>;
+
+  // The xoshiro256** state of all the lanes of a block:
+  struct rng_lanes_t {
+    alignas(64) word_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+
+    // Advance all lanes, writing one raw 64-bit output per lane to r:
+    void next(word_t* r)
+    {
+      for (size_t l = 0; l < LANES; ++l) {
+        const auto x = s1[l] * 5;
+        r[l] = ((x << 7) | (x >> 57)) * 9;
+        const auto t = s1[l] << 17;
+        s2[l] ^= s0[l];
+        s3[l] ^= s1[l];
+        s1[l] ^= s2[l];
+        s0[l] ^= s3[l];
+        s2[l] ^= t;
+        s3[l] = (s3[l] << 45) | (s3[l] >> 19);
+      }
+    }
+
+    // Advance all lanes, writing one uniform double in [0,1) per lane to u.
+    // The top 52 bits become the mantissa of a double in [1,2).
+    void uniform(double* u)
+    {
+      alignas(64) word_t r[LANES];
+      next(r);
+      for (size_t l = 0; l < LANES; ++l) {
+        const word_t bits = (r[l] >> 12) | 0x3ff0000000000000ULL;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        u[l] = d - 1.;
+      }
+    }
+  };
+
+  // Index of unit u of lane l of block b in the genotype and fitness arrays:
+  size_t idx(size_t b, size_t u, size_t l) const { return (b * units_ + u) * LANES + l; }
+
+  // The fitness f of the genotypes g of all lanes: decode them all at once,
+  // then score them.
+  void evaluate(const word_t* g, double* f) const
+  {
+    alignas(64) phenotype_t p[LANES];
+    fit_.decode(g, p, LANES);
+    for (size_t l = 0; l < LANES; ++l) {
+      f[l] = fit_.score(p[l], len_);
+    }
+  }
+
+  // Statistics of one block, and record newly solved experiments:
+  gen_stats_t block_stats_at(size_t b, unsigned g)
+  {
+    gen_stats_t ret;
+    const auto lanes = std::min(LANES, experiments_ - b * LANES);
+    for (size_t l = 0; l < lanes; ++l) {
+      unsigned opt = 0;
+      for (size_t u = 0; u < units_; ++u) {
+        const auto f = fitness_[idx(b, u, l)];
+        opt += f == optimum_;
+        ret.add(f, f == optimum_);
+      }
+      if (opt == units_ && g < gens_[b * LANES + l]) {
+        gens_[b * LANES + l] = g;
+      }
+    }
+    return ret;
+  }
+
+  // Pick the organism to work on in each lane, and read its genotype and
+  // fitness into g and f:
+  void select(size_t b, word_t* org, word_t* g, double* f)
+  {
+    alignas(64) double u_org[LANES];
+    if (units_ > 1) {
+      rng_[b].uniform(u_org);
+    }
+    for (size_t l = 0; l < LANES; ++l) {
+      org[l] = units_ > 1? word_t(u_org[l] * units_) : 0;
+      g[l] = 0;
+      f[l] = 0;
+    }
+    for (size_t u = 0; u < units_; ++u) {
+      const word_t* __restrict gu = &geno_[idx(b, u, 0)];
+      const double* __restrict fu = &fitness_[idx(b, u, 0)];
+      for (size_t l = 0; l < LANES; ++l) {
+        g[l] = org[l] == u? gu[l] : g[l];
+        f[l] = org[l] == u? fu[l] : f[l];
+      }
+    }
+  }
+
+  // Write back the accepted offspring (acc[l] is 0 or 1):
+  void accept(size_t b, const word_t* org, const word_t* acc, const word_t* g, const double* f)
+  {
+    for (size_t u = 0; u < units_; ++u) {
+      word_t* __restrict gu = &geno_[idx(b, u, 0)];
+      double* __restrict fu = &fitness_[idx(b, u, 0)];
+      for (size_t l = 0; l < LANES; ++l) {
+        const bool replace = acc[l] & (org[l] == u);
+        gu[l] = replace? g[l] : gu[l];
+        fu[l] = replace? f[l] : fu[l];
+      }
+    }
+  }
+
+  // One generation of simulated annealing for all lanes of a block, with
+  // the same semantics as Sim::SA_generation(). A move that doesn't lose
+  // fitness has acceptance probability exp(0) = 1.
+  void SA_block(size_t b, const acceptance_t& acceptance)
+  {
+    alignas(64) word_t org[LANES], g[LANES];
+    alignas(64) double f0[LANES], f1[LANES], u_bit[LANES], u_acc[LANES];
+    alignas(64) word_t acc[LANES];
+    const word_t* __restrict bit_masks = bit_masks_.data();
+
+    select(b, org, g, f0);
+    rng_[b].uniform(u_bit);
+    rng_[b].uniform(u_acc);
+    for (size_t l = 0; l < LANES; ++l) {
+      g[l] ^= bit_masks[int64_t(u_bit[l] * len_)];
+    }
+    evaluate(g, f1);
+    if (acceptance.table) {
+      const double* __restrict boltzmann = acceptance.table;
+      for (size_t l = 0; l < LANES; ++l) {
+        const auto loss = f0[l] - f1[l];
+        acc[l] = u_acc[l] < boltzmann[int64_t(std::max(loss, 0.))];
+      }
+    } else {
+      for (size_t l = 0; l < LANES; ++l) {
+        const auto d = int64_t(std::max(f0[l] - f1[l], 0.));
+        acc[l] = d == 0 || u_acc[l] < acceptance(d);
+      }
+    }
+    accept(b, org, acc, g, f1);
+  }
+
+  // One generation of (1+1)-ES for all lanes of a block, with the same
+  // semantics as Sim::ES_generation().
+  void ES_block(size_t b)
+  {
+    alignas(64) word_t org[LANES], g[LANES], mask[LANES];
+    alignas(64) double f0[LANES], f1[LANES], u[LANES];
+    alignas(64) word_t acc[LANES];
+
+    select(b, org, g, f0);
+    for (size_t l = 0; l < LANES; ++l) {
+      mask[l] = 0;
+    }
+    for (size_t i = 0; i < len_; ++i) {
+      rng_[b].uniform(u);
+      for (size_t l = 0; l < LANES; ++l) {
+        mask[l] |= word_t(u[l] < p_m_) << i;
+      }
+    }
+    for (size_t l = 0; l < LANES; ++l) {
+      g[l] ^= mask[l];
+    }
+    evaluate(g, f1);
+    for (size_t l = 0; l < LANES; ++l) {
+      acc[l] = f1[l] > f0[l];
+    }
+    accept(b, org, acc, g, f1);
+  }
+
+  const Fitness fit_;
+  const size_t len_, units_, experiments_, nblocks_;
+  const double optimum_, p_m_;
+  std::vector<rng_lanes_t> rng_;
+  std::vector<word_t> geno_;
+  std::vector<double> fitness_;
+  std::vector<word_t> bit_masks_;  // bit_masks_[i] = 1 << i (a table, so
+                                   // the SA flip vectorizes as a gather)
+  std::vector<unsigned> gens_;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// How the bit-sliced engine evaluates a fitness policy: with sliced
+// arithmetic where the policy has a simple form, namely an adder for the
+// number of ones, and for one-max on standard binary or binary-reflected
+// Gray coding, a subtraction and absolute value of the (prefix-XORed)
+// genotype bits; and otherwise, from a fitness table.
+enum class sliced_fitness_t { TABLE, ONES, ONEMAX_SB, ONEMAX_BRG };
+
+template <class Fitness>
+constexpr sliced_fitness_t sliced_fitness = sliced_fitness_t::TABLE;
+template <class Rep>
+constexpr sliced_fitness_t sliced_fitness<CountOnes<Rep>> = sliced_fitness_t::ONES;
+template <>
+constexpr sliced_fitness_t sliced_fitness<OneMax<StdBinaryRep>> = sliced_fitness_t::ONEMAX_SB;
+template <>
+constexpr sliced_fitness_t sliced_fitness<OneMax<BrgRep>> = sliced_fitness_t::ONEMAX_BRG;
+
+// The bit-sliced engine runs 64 experiments per machine word: bit j of
+// word i of a block holds bit i of experiment j's genotype, and likewise
+// for the bits of its fitness. Mutation, fitness evaluation, comparison and
+// acceptance are then word-wide logic operations on all 64 experiments at
+// once. Fitness is evaluated as FIT says (see sliced_fitness_t): with
+// sliced arithmetic in O(len * fitness bits) operations, for genotypes of up
+// to 63 bits, or from a fitness table, with a multiplexer tree over the
+// genotype bits per fitness bit, in O(2^len * fitness bits), so for short
+// genotypes only (MAX_TABLE_BITS). Either way, fitness values must be
+// nonnegative integers.
+// Random choices are exact: uniform indices by rejection sampling on sliced
+// random bits, and Bernoulli trials by comparing sliced random bits with the
+// binary expansion of the probability, only as far as each lane needs.
+// Each block of 64 experiments draws from its own xoshiro256** stream.
+template <sliced_fitness_t FIT, algorithm_t ALG>
+class BitSliceEngine : public BlockEngine<BitSliceEngine<FIT, ALG>, ALG> {
+ public:
+  static constexpr size_t MAX_TABLE_BITS = 12;
+  static constexpr size_t MAX_BITS = FIT == sliced_fitness_t::TABLE? MAX_TABLE_BITS
+                                                                   : bits_t::WORD_BITS - 1;
+  static constexpr size_t LANES = 64;
+  using word_t = bits_t::word_t;
+
+  // An engine for the fitness policy fitness, whose fitness table (needed for
+  // sliced_fitness_t::TABLE only) is table:
+  template <class Fitness>
+  BitSliceEngine(const config_t& cfg, const Fitness& fitness, const fitness_table_t* table)
+  : BlockEngine<BitSliceEngine, ALG>(cfg, fitness.optimum(cfg.len))
+  , len_(cfg.len), units_(cfg.popsize), experiments_(cfg.experiments)
+  , nblocks_((experiments_ + LANES - 1) / LANES), fbits_(1), optimum_(fitness.optimum(cfg.len))
+  , p_m_(1. / len_), a_(0), rng_(), geno_(), fit_(), leaves_(), unit_masks_(nblocks_ * units_)
+  , solved_(nblocks_, 0), gens_(experiments_, cfg.generations)
+  {
+    static_assert(sliced_fitness<Fitness> == FIT, "The engine must suit the fitness policy");
+    assert(len_ > 0 && len_ <= MAX_BITS);
+    assert(ALG == algorithm_t::ES || optimum_ <= BitSliceEngine::MAX_OPTIMUM);
+    assert(integral(cfg, table));
+    while (fbits_ < bits_t::WORD_BITS && (word_t(1) << fbits_) <= optimum_) {
+      ++fbits_;
+    }
+
+    if constexpr (FIT == sliced_fitness_t::ONEMAX_SB || FIT == sliced_fitness_t::ONEMAX_BRG) {
+      a_ = fitness.a;
+    } else if constexpr (FIT == sliced_fitness_t::TABLE) {
+      // Leaf k * 2^len + g of the multiplexer trees is all ones if bit k of
+      // the fitness of genotype g is set:
+      const size_t n = size_t(1) << len_;
+      leaves_.resize(fbits_ * n);
+      for (size_t k = 0; k < fbits_; ++k) {
+        for (size_t g = 0; g < n; ++g) {
+          leaves_[k * n + g] = (word_t(table->fitness[g]) >> k) & 1? ~word_t(0) : 0;
+        }
+      }
+    }
+
+    geno_.resize(nblocks_ * units_ * len_);
+    fit_.resize(nblocks_ * units_ * fbits_);
+    const bool start = cfg.start >= 0;
+    word_t g0 = 0;
+    if constexpr (FIT == sliced_fitness_t::TABLE) {
+      g0 = start? start_genotype(cfg, TabulatedFitness{ table }) : 0;
+    } else {
+      g0 = start? start_genotype(cfg, fitness) : 0;
+    }
+    for (size_t b = 0; b < nblocks_; ++b) {
+      rng_.push_back(rng_t::stream(cfg.seed, b));
+      for (size_t u = 0; u < units_; ++u) {
+        for (size_t i = 0; i < len_; ++i) {
+          const word_t r = rng_[b]();
+          geno(b, u)[i] = !start? r : (g0 >> i) & 1? ~word_t(0) : 0;
+        }
+        evaluate(geno(b, u), fit(b, u));
+      }
+    }
+  }
+
+  // Are all fitness values nonnegative integers, as the engine needs? Only
+  // a fitness table needs checking, and one-max's target a must be in range.
+  static bool integral(const config_t& cfg, const fitness_table_t* table)
+  {
+    switch (FIT) {
+      case sliced_fitness_t::TABLE:
+        return table->optimum < (1 << MAX_TABLE_BITS)
+            && std::all_of(table->fitness.cbegin(), table->fitness.cend(), [&](double f) {
+                 return f >= 0 && f == std::floor(f) && f <= table->optimum; });
+      case sliced_fitness_t::ONES: return true;
+      default: return !(cfg.a >> cfg.len);
+    }
+  }
+
+  size_t size() const { return nblocks_; }
+  size_t unit_size() const { return LANES; }
+
+  const std::vector<unsigned>& solved_at() const { return gens_; }
+
+ private:
+  friend class BlockEngine<BitSliceEngine, ALG>;
+
+  // The genotype slices and fitness slices of unit u of block b:
+  word_t* geno(size_t b, size_t u) { return &geno_[(b * units_ + u) * len_]; }
+  word_t* fit(size_t b, size_t u) { return &fit_[(b * units_ + u) * fbits_]; }
+
+  // The lanes of block b that work on each unit this generation:
+  word_t* unit_masks(size_t b) { return &unit_masks_[b * units_]; }
+
+  // Lanes with a given constant value in a sliced number of fbits_ bits:
+  word_t equals(const word_t* x, word_t value) const
+  {
+    word_t ret = ~word_t(0);
+    for (size_t k = 0; k < fbits_; ++k) {
+      ret &= (value >> k) & 1? x[k] : ~x[k];
+    }
+    return ret;
+  }
+
+  // Lanes where sliced number x is greater than sliced number y:
+  word_t greater(const word_t* x, const word_t* y) const
+  {
+    word_t gt = 0, eq = ~word_t(0);
+    for (size_t k = fbits_; k-- > 0; ) {
+      gt |= eq & x[k] & ~y[k];
+      eq &= ~(x[k] ^ y[k]);
+    }
+    return gt;
+  }
+
+  // The highest (or lowest) value of sliced number x among the given lanes:
+  // going from the top bit down, keep the lanes that have that bit set (or
+  // clear), if there are any.
+  word_t extreme(const word_t* x, word_t lanes, bool highest) const
+  {
+    word_t ret = 0;
+    for (size_t k = fbits_; k-- > 0; ) {
+      const auto keep = lanes & (highest? x[k] : ~x[k]);
+      if (keep) {
+        lanes = keep;
+      }
+      ret |= word_t(highest == bool(keep)) << k;
+    }
+    return ret;
+  }
+
+  // Sliced fitness f of sliced genotype x:
+  void evaluate(const word_t* x, word_t* f) const
+  {
+    switch (FIT) {
+      case sliced_fitness_t::TABLE: evaluate_table(x, f); break;
+      case sliced_fitness_t::ONES: evaluate_ones(x, f); break;
+      default: evaluate_onemax(x, f); break;
+    }
+  }
+
+  // The number of ones, by adding up the genotype bits in a ripple-carry
+  // counter:
+  void evaluate_ones(const word_t* x, word_t* f) const
+  {
+    std::fill(f, f + fbits_, 0);
+    for (size_t i = 0; i < len_; ++i) {
+      word_t carry = x[i];
+      for (size_t k = 0; k < fbits_ && carry; ++k) {
+        const auto next = f[k] & carry;
+        f[k] ^= carry;
+        carry = next;
+      }
+    }
+  }
+
+  // One-max, 2^len - 1 - |p - a|: the phenotype p is the genotype itself in
+  // standard binary, or its prefix XOR from the top bit down (as
+  // brg_decode() computes it) in Gray coding. Subtract a, negate the lanes
+  // that borrowed out of the top bit (two's complement, so complement and
+  // add one), and the fitness is then the complement of |p - a| in len bits.
+  void evaluate_onemax(const word_t* x, word_t* f) const
+  {
+    std::array<word_t, MAX_SLICES> p;
+    word_t prefix = 0;
+    for (size_t i = len_; i-- > 0; ) {
+      prefix ^= x[i];
+      p[i] = FIT == sliced_fitness_t::ONEMAX_BRG? prefix : x[i];
+    }
+
+    word_t borrow = 0;
+    for (size_t k = 0; k < len_; ++k) {
+      const word_t a = (a_ >> k) & 1? ~word_t(0) : 0;
+      const auto d = p[k] ^ a ^ borrow;
+      borrow = (~p[k] & a) | (~(p[k] ^ a) & borrow);
+      p[k] = d;
+    }
+    const auto negative = borrow;
+    word_t carry = negative;
+    for (size_t k = 0; k < len_; ++k) {
+      const auto d = p[k] ^ negative;
+      f[k] = ~(d ^ carry);
+      carry &= d;
+    }
+  }
+
+  // From the fitness table: each fitness bit is a tree of multiplexers over
+  // its leaves, selecting on genotype bit 0 at the bottom level and on the
+  // top genotype bit at the root.
+  void evaluate_table(const word_t* x, word_t* f) const
+  {
+    const size_t n = size_t(1) << len_;
+    std::array<word_t, (size_t(1) << MAX_TABLE_BITS) / 2> level;
+
+    for (size_t k = 0; k < fbits_; ++k) {
+      const word_t* leaves = &leaves_[k * n];
+      for (size_t j = 0; j < n / 2; ++j) {
+        level[j] = leaves[2 * j] ^ (x[0] & (leaves[2 * j] ^ leaves[2 * j + 1]));
+      }
+      for (size_t i = 1; i < len_; ++i) {
+        for (size_t j = 0; j < (n >> (i + 1)); ++j) {
+          level[j] = level[2 * j] ^ (x[i] & (level[2 * j] ^ level[2 * j + 1]));
+        }
+      }
+      f[k] = level[0];
+    }
+  }
+
+  // Split the lanes into n classes, uniformly and independently per lane:
+  // draw sliced random numbers of enough bits, and redraw the lanes with a
+  // number of n or more.
+  static void uniform_choice(rng_t& rng, size_t n, word_t* masks)
+  {
+    size_t nbits = 0;
+    while ((size_t(1) << nbits) < n) {
+      ++nbits;
+    }
+    std::fill(masks, masks + n, 0);
+
+    for (word_t pending = ~word_t(0); pending; ) {
+      std::array<word_t, bits_t::WORD_BITS> r;
+      for (size_t j = 0; j < nbits; ++j) {
+        r[j] = rng();
+      }
+      for (size_t v = 0; v < n; ++v) {
+        word_t eq = pending;
+        for (size_t j = 0; j < nbits; ++j) {
+          eq &= (v >> j) & 1? r[j] : ~r[j];
+        }
+        masks[v] |= eq;
+        pending &= ~eq;
+      }
+    }
+  }
+
+  // Each of the given lanes succeeds independently with probability p. A
+  // lane's uniform number U is drawn one random bit at a time, and the lane
+  // is decided as soon as U's bits differ from p's binary digits.
+  static word_t bernoulli(rng_t& rng, double p, word_t lanes)
+  {
+    word_t success = 0;
+    for (word_t undecided = lanes; undecided && p > 0; ) {
+      p *= 2;
+      const bool digit = p >= 1;
+      p -= digit;
+      const word_t r = rng();
+      if (digit) {
+        success |= undecided & ~r;
+        undecided &= r;
+      } else {
+        undecided &= ~r;
+      }
+    }
+    return success;
+  }
+
+  // Statistics of one block, and record newly solved experiments:
+  gen_stats_t block_stats_at(size_t b, unsigned g)
+  {
+    gen_stats_t ret;
+    const auto lanes = std::min(LANES, experiments_ - b * LANES);
+    const word_t valid = lanes == LANES? ~word_t(0) : (word_t(1) << lanes) - 1;
+
+    word_t solved = valid;
+    for (size_t u = 0; u < units_; ++u) {
+      const auto f = fit(b, u);
+      const auto opt = equals(f, optimum_) & valid;
+      solved &= opt;
+
+      // Sums of f and f^2 over lanes, from the products of fitness bits
+      // (f^2 = sum over k, j of 2^(k+j) f_k f_j):
+      gen_stats_t us;
+      us.count = lanes;
+      us.optimal = __builtin_popcountll(opt);
+      for (size_t k = 0; k < fbits_; ++k) {
+        us.fitness += std::ldexp(__builtin_popcountll(f[k] & valid), k);
+        for (size_t j = 0; j < fbits_; ++j) {
+          us.sumsq += std::ldexp(__builtin_popcountll(f[k] & f[j] & valid), k + j);
+        }
+      }
+      us.min = extreme(f, valid, false);
+      us.max = extreme(f, valid, true);
+      ret += us;
+    }
+
+    for (word_t newly = solved & ~solved_[b]; newly; newly &= newly - 1) {
+      gens_[b * LANES + __builtin_ctzll(newly)] = g;
+    }
+    solved_[b] |= solved;
+    return ret;
+  }
+
+  // Replace unit u of block b with the offspring (x, f) in lanes acc:
+  void accept(size_t b, size_t u, word_t acc, const word_t* x, const word_t* f)
+  {
+    for (size_t i = 0; i < len_; ++i) {
+      geno(b, u)[i] = (x[i] & acc) | (geno(b, u)[i] & ~acc);
+    }
+    for (size_t k = 0; k < fbits_; ++k) {
+      fit(b, u)[k] = (f[k] & acc) | (fit(b, u)[k] & ~acc);
+    }
+  }
+
+  // One generation of simulated annealing for all lanes of a block, with
+  // the same semantics as Sim::SA_generation(): lanes that lose fitness d
+  // accept with probability acceptance(d) = exp(-d / temp), all others
+  // always accept.
+  void SA_block(size_t b, const acceptance_t& acceptance)
+  {
+    auto& rng = rng_[b];
+    const auto unit_masks = this->unit_masks(b);
+    std::array<word_t, MAX_SLICES> bit_masks, x, f1, diff;
+
+    uniform_choice(rng, units_, unit_masks);
+    uniform_choice(rng, len_, bit_masks.data());
+
+    for (size_t u = 0; u < units_; ++u) {
+      if (!unit_masks[u]) {
+        continue;
+      }
+      const auto g = geno(b, u);
+      const auto f0 = fit(b, u);
+      for (size_t i = 0; i < len_; ++i) {
+        x[i] = g[i] ^ (unit_masks[u] & bit_masks[i]);
+      }
+      evaluate(x.data(), f1.data());
+
+      // diff = f0 - f1, and the lanes where that's positive:
+      word_t borrow = 0, nonzero = 0;
+      for (size_t k = 0; k < fbits_; ++k) {
+        diff[k] = f0[k] ^ f1[k] ^ borrow;
+        borrow = (~f0[k] & f1[k]) | (~(f0[k] ^ f1[k]) & borrow);
+        nonzero |= diff[k];
+      }
+      // Decide the lanes by increasing loss, only the losses there are:
+      word_t worse = nonzero & ~borrow;
+      word_t acc = ~worse;
+      while (worse) {
+        const auto d = extreme(diff.data(), worse, false);
+        const auto lanes = worse & equals(diff.data(), d);
+        acc |= bernoulli(rng, acceptance(d), lanes);
+        worse &= ~lanes;
+      }
+      accept(b, u, acc & unit_masks[u], x.data(), f1.data());
+    }
+  }
+
+  // One generation of (1+1)-ES for all lanes of a block, with the same
+  // semantics as Sim::ES_generation().
+  void ES_block(size_t b)
+  {
+    auto& rng = rng_[b];
+    const auto unit_masks = this->unit_masks(b);
+    std::array<word_t, MAX_SLICES> x, f1;
+
+    uniform_choice(rng, units_, unit_masks);
+
+    for (size_t u = 0; u < units_; ++u) {
+      if (!unit_masks[u]) {
+        continue;
+      }
+      const auto g = geno(b, u);
+      for (size_t i = 0; i < len_; ++i) {
+        x[i] = g[i] ^ bernoulli(rng, p_m_, unit_masks[u]);
+      }
+      evaluate(x.data(), f1.data());
+      accept(b, u, greater(f1.data(), fit(b, u)) & unit_masks[u], x.data(), f1.data());
+    }
+  }
+
+  static constexpr size_t MAX_SLICES = bits_t::WORD_BITS;  // Of a genotype or fitness
+
+  const size_t len_, units_, experiments_, nblocks_;
+  size_t fbits_;            // How many bits in a sliced fitness value
+  const word_t optimum_;
+  const double p_m_;
+  word_t a_;                // The target of one-max
+  std::vector<rng_t> rng_;
+  std::vector<word_t> geno_, fit_;
+  std::vector<word_t> leaves_;     // Of the multiplexer trees (TABLE)
+  std::vector<word_t> unit_masks_;  // Scratch for unit_masks(), per block
+  std::vector<word_t> solved_;     // Lanes of each block ever found solved
+  std::vector<unsigned> gens_;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Exact models: rather than sampling experiments, these work with the
+// Markov chain of a single organism over all 2^len genotypes of a fitness
+// table (the chains of markovAnalysis.py and ES_markov.py).
+
+// The optimal genotypes of a fitness table:
+std::vector<uint32_t>
+optimal_genotypes(const fitness_table_t& table)
+{
+  std::vector<uint32_t> ret;
+  for (size_t x = 0; x < table.fitness.size(); ++x) {
+    if (table.fitness[x] == table.optimum) {
+      ret.push_back(x);
+    }
+  }
+  return ret;
+}
+
+// Probability of accepting an SA move that changes fitness by d at a given
+// temperature (see Sim::SA_generation(): moves that don't lose fitness
+// always succeed). At temperature 0, only those do.
+inline double
+sa_accept(double d, double temp)
+{
+  return d >= 0? 1. : temp > 0? exp(d / temp) : 0.;
+}
+
+// The (1+1)-ES transition kernel: mutate every bit with probability
+// p_m = 1/len, and accept only a strictly fitter offspring. Mutation is a
+// tensor product of len 2x2 matrices, which a butterfly (as in the fast
+// Walsh-Hadamard transform) applies to a whole vector in O(len 2^len).
+// Acceptance depends on fitness, so the kernel is applied one fitness level
+// at a time (see sweep()): with a butterfly per level, or with a gather over
+// all pairs of genotypes of different fitness, whichever is cheaper.
+// A sweep thus costs O(levels len 2^len), or O(pairs): cheap for fitness
+// functions with few levels, like ones (len + 1 of them), but quadratic in
+// 2^len for ones with about as many levels as genotypes, like onemax, which
+// takes seconds per sweep from about 16 bits.
+class es_kernel_t {
+ public:
+  es_kernel_t(const fitness_table_t& table, size_t len)
+  : len_(len), order_(size_t(1) << len), levels_(), mutation_(len + 1)
+  , stay_(order_.size()), butterfly_(false), acc_(), work_()
+  {
+    const auto& fit = table.fitness;
+
+    // The genotypes in increasing order of fitness, and where each fitness
+    // level starts:
+    std::iota(order_.begin(), order_.end(), 0);
+    parallel_sort(order_.begin(), order_.end(),
+        [&](uint32_t x, uint32_t y) { return fit[x] < fit[y]; });
+    uint64_t pairs = 0;
+    for (size_t k = 0; k < order_.size(); ++k) {
+      if (k == 0 || fit[order_[k]] > fit[order_[k - 1]]) {
+        levels_.push_back(k);
+      }
+      pairs += levels_.back();
+    }
+    levels_.push_back(order_.size());
+
+    // The probability of mutating exactly a given set of h bits:
+    const double p_m = 1. / len_;
+    for (size_t h = 0; h <= len_; ++h) {
+      mutation_[h] = std::pow(p_m, h) * std::pow(1 - p_m, len_ - h);
+    }
+
+    butterfly_ = (uint64_t(levels_.size()) * (len_ + 1) << len_) < pairs;
+
+    // The probability of rejecting the offspring, i.e., of not moving:
+    sweep([](size_t) { return 1.; }, false, stay_);
+    for (auto& st : stay_) {
+      st = 1 - st;
+    }
+  }
+
+  double stay(size_t x) const { return stay_[x]; }
+
+  // Sweep the fitness levels in increasing (or decreasing) order, and set
+  // out[y] to the sum over the genotypes x of all the levels before y's of
+  // value(x) times the probability of mutating x into y. value(y) is read
+  // after out[y] is set, so it may depend on it.
+  template <class Value>
+  void sweep(const Value& value, bool increasing, std::vector<double>& out)
+  {
+    sweep<1>([&](size_t y) { return std::array<double, 1>{ value(y) }; }, increasing, { &out });
+  }
+
+  // The same for K distributions at once, where value(y) returns an array
+  // of K values, sharing the level order, the gathers' mutation
+  // probabilities, and the butterflies' passes over memory. The values are
+  // interleaved in the buffers, K per genotype.
+  template <size_t K, class Value>
+  void sweep(const Value& value, bool increasing, const std::array<std::vector<double>*, K>& out)
+  {
+    acc_.assign(order_.size() * K, 0.);
+    if (butterfly_) {
+      work_.resize(acc_.size());
+    }
+    const size_t nlevels = levels_.size() - 1;
+    for (size_t n = 0; n < nlevels; ++n) {
+      const auto l = increasing? n : nlevels - 1 - n;
+      const size_t first = increasing? 0 : levels_[l + 1];
+      const size_t last = increasing? levels_[l] : order_.size();
+      if (butterfly_ && n > 0) {
+        work_ = acc_;
+        mutate<K>(work_);
+      }
+      parallel_for(size_t(levels_[l]), size_t(levels_[l + 1]), [&](size_t k) {
+        const auto y = order_[k];
+        std::array<double, K> sum {};
+        if (butterfly_) {
+          for (size_t c = 0; c < K && n > 0; ++c) {
+            sum[c] = work_[y * K + c];
+          }
+        } else {
+          for (size_t j = first; j < last; ++j) {
+            const auto x = order_[j];
+            const auto m = mutation_[__builtin_popcountll(y ^ x)];
+            for (size_t c = 0; c < K; ++c) {
+              sum[c] += acc_[x * K + c] * m;
+            }
+          }
+        }
+        for (size_t c = 0; c < K; ++c) {
+          (*out[c])[y] = sum[c];
+        }
+        const auto v = value(y);
+        std::copy(v.begin(), v.end(), &acc_[y * K]);
+      });
+    }
+  }
+
+ private:
+  // Apply the mutation kernel to v in place, one bit (one 2x2 matrix) at a
+  // time. The low bits only mix entries within aligned blocks of
+  // 2^BLOCK_BITS, so they're all applied to one cache-sized block at a
+  // time, and each higher bit takes a pass over all of v.
+  static constexpr size_t BLOCK_BITS = 12;
+
+  // (v holds K interleaved vectors.)
+  template <size_t K>
+  void mutate(std::vector<double>& v) const
+  {
+    const size_t n = v.size() / K;
+    const size_t low = std::min(len_, BLOCK_BITS);
+    parallel_for(size_t(0), n >> low, [&](size_t blk) {
+      for (size_t i = 0; i < low; ++i) {
+        mutate_bit<K>(&v[(blk << low) * K], i, 0, size_t(1) << (low - 1));
+      }
+    });
+    for (size_t i = low; i < len_; ++i) {
+      parallel_for(blocked_range<size_t>(0, n / 2), [&](const blocked_range<size_t>& r) {
+        mutate_bit<K>(v.data(), i, r.begin(), r.end());
+      });
+    }
+  }
+
+  // Apply the 2x2 mutation matrix of bit i to pairs [first, last) of v, where
+  // pair j is the two genotypes whose indices are j with a bit inserted at i:
+  template <size_t K>
+  void mutate_bit(double* v, size_t i, size_t first, size_t last) const
+  {
+    const double p_m = 1. / len_;
+    const size_t bit = size_t(1) << i;
+    for (size_t j = first; j < last; ++j) {
+      const auto x = ((j & ~(bit - 1)) << 1) | (j & (bit - 1));
+      for (size_t c = 0; c < K; ++c) {
+        const auto a = v[x * K + c], b = v[(x | bit) * K + c];
+        v[x * K + c] = a + p_m * (b - a);
+        v[(x | bit) * K + c] = b + p_m * (a - b);
+      }
+    }
+  }
+
+  const size_t len_;
+  std::vector<uint32_t> order_;   // Genotypes by increasing fitness
+  std::vector<uint32_t> levels_;  // Where each fitness level starts in order_
+  std::vector<double> mutation_;  // Probability of an h-bit mutation
+  std::vector<double> stay_;      // Probability of rejecting the offspring
+  bool butterfly_;                // Sweep with butterflies rather than gathers?
+  std::vector<double> acc_, work_;  // sweep() buffers
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// The exact engine samples nothing: it propagates the probability
+// distribution of an organism's genotype over all 2^len genotypes, one
+// generation at a time, from the uniform initial distribution, through the
+// SA move at that generation's temperature, or through the ES kernel. Each
+// generation works on one of popsize organisms, so an organism takes the
+// step with probability 1/popsize.
+// The statistics are the expected statistics of experiments x popsize
+// organisms, with no sampling noise (the confidence interval is that of a
+// sampling run of that size). The mean generation to an optimal solution
+// comes from a second distribution, of the organisms that have never been
+// optimal, which is only the experiment's for a population of one, so for
+// larger populations it isn't reported (see first_passage()).
+// SA has len moves out of each genotype, and the generation is a gather
+// per genotype over its neighbors. The fitness change of every move is
+// coded once (see moves_), so only the acceptance probabilities of the
+// distinct changes, at the generation's temperature, are computed per
+// generation.
+template <algorithm_t ALG>
+class ExactEngine {
+ public:
+  static constexpr size_t MAX_BITS = fitness_table_t::MAX_BITS;
+
+  ExactEngine(const config_t& cfg, const fitness_table_t& table)
+  : table_(table), len_(cfg.len), units_(cfg.popsize), generations_(cfg.generations)
+  , organisms_(uint64_t(cfg.experiments) * cfg.popsize), schedule_(cfg)
+  , prob_(size_t(1) << len_, 1. / (size_t(1) << len_)), unsolved_(prob_)
+  , next_prob_(prob_.size()), next_unsolved_(prob_.size())
+  , optima_(optimal_genotypes(table)), moves_(), losses_(), accept_(), es_()
+  , solved_at_(cfg.generations + 1, 0.)
+  {
+    assert(len_ > 0 && len_ <= MAX_BITS);
+    if (cfg.start >= 0) {
+      std::fill(prob_.begin(), prob_.end(), 0.);
+      prob_[start_genotype(cfg, TabulatedFitness{ &table })] = 1;
+      unsolved_ = prob_;
+    }
+    if constexpr (ALG == algorithm_t::ES) {
+      es_ = std::make_unique<es_kernel_t>(table, len_);
+    } else {
+      // Of a move and its reverse, at most one loses fitness. The move from
+      // genotype y across bit i is coded as k << 1 | loses, where loses
+      // says whether it's this move that loses, and k indexes the fitness
+      // change of the losing one in losses_ (k = 0 for no change).
+      std::unordered_map<double, uint32_t> index { { 0., 0 } };
+      losses_.push_back(0.);
+      moves_.resize(prob_.size() * len_);
+      for (size_t y = 0; y < prob_.size(); ++y) {
+        for (size_t i = 0; i < len_; ++i) {
+          const auto d = fit(y ^ (size_t(1) << i)) - fit(y);
+          const auto loss = d < 0? d : d > 0? -d : 0.;
+          const auto it = index.emplace(loss, losses_.size());
+          if (it.second) {
+            losses_.push_back(loss);
+          }
+          moves_[y * len_ + i] = it.first->second << 1 | (d < 0);
+        }
+      }
+      accept_.resize(losses_.size());
+    }
+  }
+
+  gen_stats_t generation(unsigned g)
+  {
+    auto ret = reduce_stats(prob_.size(), 1, [&](size_t first, size_t last) {
+      gen_stats_t acc;
+      for (size_t x = first; x < last; ++x) {
+        const auto f = fit(x);
+        acc.fitness += prob_[x] * f;
+        acc.sumsq += prob_[x] * f * f;
+        if (prob_[x] > 0) {
+          acc.min = std::min(acc.min, f);
+          acc.max = std::max(acc.max, f);
+        }
+      }
+      return acc;
+    });
+    double hit = 0;
+    for (const auto x : optima_) {
+      ret.optimal += prob_[x];
+      hit += unsolved_[x];
+      unsolved_[x] = 0;
+    }
+    ret.count = organisms_;
+    ret.optimal *= organisms_;
+    ret.fitness *= organisms_;
+    ret.sumsq *= organisms_;
+    solved_at_[g] = hit;
+
+    step(g);
+    return ret;
+  }
+
+  // A single unit of work:
+  size_t size() const { return 1; }
+  size_t unit_size() const { return organisms_ / units_; }
+
+  gen_stats_t run_generation(size_t, size_t, unsigned g) { return generation(g); }
+
+  // Probability of an experiment first being found solved at generation g
+  // (entry g), as in the other engines:
+  const std::vector<double>& first_passage() const { return solved_at_; }
+
+ private:
+  double fit(size_t x) const { return table_.fitness[x]; }
+
+  // Advance both distributions by one generation:
+  void step(unsigned g)
+  {
+    const double move = 1. / units_;  // Probability that an organism is picked
+    if constexpr (ALG == algorithm_t::SA) {
+      for (size_t k = 0; k < losses_.size(); ++k) {
+        accept_[k] = sa_accept(losses_[k], schedule_.temp(g));
+      }
+      parallel_for(size_t(0), prob_.size(), [&](size_t y) {
+        double in = 0, in_unsolved = 0, out = 0;
+        for (size_t i = 0; i < len_; ++i) {
+          const auto x = y ^ (size_t(1) << i);
+          const auto code = moves_[y * len_ + i];
+          const auto a_out = code & 1? accept_[code >> 1] : 1.;
+          const auto a_in = code & 1? 1. : accept_[code >> 1];
+          in += prob_[x] * a_in;
+          in_unsolved += unsolved_[x] * a_in;
+          out += a_out;
+        }
+        next_prob_[y] = prob_[y] + move * (in - prob_[y] * out) / len_;
+        next_unsolved_[y] = unsolved_[y] + move * (in_unsolved - unsolved_[y] * out) / len_;
+      });
+    } else {
+      es_->sweep<2>([&](size_t x) { return std::array<double, 2>{ prob_[x], unsolved_[x] }; },
+                    true, { &next_prob_, &next_unsolved_ });
+      parallel_for(size_t(0), prob_.size(), [&](size_t y) {
+        const auto out = 1 - es_->stay(y);
+        next_prob_[y] = prob_[y] + move * (next_prob_[y] - prob_[y] * out);
+        next_unsolved_[y] = unsolved_[y] + move * (next_unsolved_[y] - unsolved_[y] * out);
+      });
+    }
+    prob_.swap(next_prob_);
+    unsolved_.swap(next_unsolved_);
+  }
+
+  const fitness_table_t& table_;
+  const size_t len_, units_, generations_;
+  const uint64_t organisms_;
+  const cooling_schedule_t schedule_;
+  std::vector<double> prob_;      // Distribution of an organism's genotype
+  std::vector<double> unsolved_;  // Same, for organisms never yet optimal
+  std::vector<double> next_prob_, next_unsolved_;
+  const std::vector<uint32_t> optima_;
+  std::vector<uint32_t> moves_;   // SA: code of the move from y across bit i
+  std::vector<double> losses_;    // SA: distinct fitness changes of losing moves
+  std::vector<double> accept_;    // SA: their acceptance probability, this generation
+  std::unique_ptr<es_kernel_t> es_;
+  std::vector<double> solved_at_; // Probability of first being solved at g
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Expected hitting times: the expected number of steps (transitions) until
+// an organism first becomes optimal, from every start genotype, so 0 from an
+// optimal one. The engines count the start as generation 1, so the
+// generation they report an organism solved at is one more. They solve
+// (I - Q) t = 1, where Q holds the transition probabilities among the
+// non-optimal genotypes. Genotypes with a chance of never becoming optimal
+// (e.g., strict local optima of SA at temperature 0) get infinite times.
+
+// ES only ever moves to fitter genotypes, so the system is triangular in
+// fitness order, and is solved directly, one fitness level at a time from
+// the top: t(y) = (1 + sum over fitter z of M(y, z) t(z)) / (1 - stay(y)).
+// That's two sweeps of the ES kernel, so for fitness functions with few
+// levels, like ones, it takes seconds at 20 bits, but for ones with about a
+// level per genotype, like onemax, the time is quadratic in 2^len: it grows
+// about 15-fold per 2 bits, from half a second at 14 bits to several
+// seconds at 16, and would take about half an hour at 20.
+std::vector<double>
+es_hitting_times(const fitness_table_t& table, size_t len)
+{
+  es_kernel_t es(table, len);
+  std::vector<double> t(table.fitness.size()), out(t.size());
+  es.sweep([&](size_t y) {
+    return t[y] = table.fitness[y] == table.optimum? 0. : (1 + out[y]) / (1 - es.stay(y));
+  }, false, out);
+  return t;
+}
+
+// Parallel dot product, with the same result from run to run:
+double
+dot(const std::vector<double>& a, const std::vector<double>& b)
+{
+  return parallel_deterministic_reduce(blocked_range<size_t>(0, a.size(), 4096), 0.,
+      [&](const blocked_range<size_t>& r, double acc) {
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+          acc += a[i] * b[i];
+        }
+        return acc;
+      },
+      std::plus<double>());
+}
+
+// SA at a fixed temperature (as in markovAnalysis.py) moves to one of len
+// neighbors, so its system is sparse, and is solved iteratively with
+// Jacobi-preconditioned BiCGSTAB. The rows of the genotypes outside the
+// system (optimal, or with infinite times) are the identity, with t = 0.
+// Each iteration is cheap, but how many it takes depends on the landscape
+// and temperature: onemax at 20 bits and the default temperature takes
+// minutes on one core.
+std::vector<double>
+sa_hitting_times(const fitness_table_t& table, size_t len, double temp)
+{
+  static constexpr double TOLERANCE = 1e-10;  // Relative residual
+  static constexpr unsigned MAX_ITERATIONS = 100000;
+
+  const auto& fit = table.fitness;
+  const size_t n = fit.size();
+
+  // The probability of moving from x to its neighbor across bit i:
+  std::vector<double> edge(n * len);
+  parallel_for(size_t(0), n, [&](size_t x) {
+    for (size_t i = 0; i < len; ++i) {
+      edge[x * len + i] = sa_accept(fit[x ^ (size_t(1) << i)] - fit[x], temp) / len;
+    }
+  });
+
+  // The genotypes that surely become optimal: those that can reach an
+  // optimum without ever being able to leave the set. Shrink the set to
+  // that until it stops changing.
+  std::vector<char> sure(n, 1), reach(n);
+  for (bool changed = true; changed; ) {
+    std::fill(reach.begin(), reach.end(), 0);
+    auto queue = optimal_genotypes(table);
+    for (const auto y : queue) {
+      reach[y] = sure[y];
+    }
+    for (size_t k = 0; k < queue.size(); ++k) {
+      const auto y = queue[k];
+      for (size_t i = 0; i < len; ++i) {
+        const auto x = y ^ (size_t(1) << i);
+        if (sure[x] && !reach[x] && edge[x * len + i] > 0) {
+          reach[x] = 1;
+          queue.push_back(x);
+        }
+      }
+    }
+    changed = false;
+    for (size_t x = 0; x < n; ++x) {
+      bool keep = reach[x];
+      for (size_t i = 0; keep && fit[x] != table.optimum && i < len; ++i) {
+        keep = !edge[x * len + i] || reach[x ^ (size_t(1) << i)];
+      }
+      changed |= bool(sure[x]) != keep;
+      sure[x] = keep;
+    }
+  }
+
+  // The system's unknowns, and its diagonal (the probability of moving):
+  std::vector<char> active(n);
+  std::vector<double> diag(n, 1.);
+  for (size_t x = 0; x < n; ++x) {
+    active[x] = sure[x] && fit[x] != table.optimum;
+    if (active[x]) {
+      diag[x] = std::accumulate(&edge[x * len], &edge[x * len + len], 0.);
+    }
+  }
+
+  // out = (I - Q) v: sum over the moves out of x of their probability
+  // times v(x) - v(neighbor).
+  const auto multiply = [&](const std::vector<double>& v, std::vector<double>& out) {
+    parallel_for(size_t(0), n, [&](size_t x) {
+      if (!active[x]) {
+        out[x] = v[x];
+        return;
+      }
+      double sum = 0;
+      for (size_t i = 0; i < len; ++i) {
+        sum += edge[x * len + i] * (v[x] - v[x ^ (size_t(1) << i)]);
+      }
+      out[x] = sum;
+    });
+  };
+  const auto precondition = [&](const std::vector<double>& v, std::vector<double>& out) {
+    parallel_for(size_t(0), n, [&](size_t x) { out[x] = v[x] / diag[x]; });
+  };
+  // a += alpha * b:
+  const auto axpy = [&](std::vector<double>& a, double alpha, const std::vector<double>& b) {
+    parallel_for(size_t(0), n, [&](size_t x) { a[x] += alpha * b[x]; });
+  };
+
+  std::vector<double> t(n, 0.), r(n), r0(n), p(n, 0.), v(n, 0.), y(n), s(n), z(n), w(n);
+  for (size_t x = 0; x < n; ++x) {
+    r[x] = active[x];
+  }
+  r0 = r;
+  const double bnorm = std::sqrt(dot(r, r));
+  double rho = 1, alpha = 1, omega = 1, resid = bnorm;
+  unsigned iter = 0;
+
+  while (resid > TOLERANCE * bnorm && iter++ < MAX_ITERATIONS) {
+    const double rho1 = dot(r0, r);
+    const double beta = (rho1 / rho) * (alpha / omega);
+    rho = rho1;
+    parallel_for(size_t(0), n, [&](size_t x) { p[x] = r[x] + beta * (p[x] - omega * v[x]); });
+    precondition(p, y);
+    multiply(y, v);
+    alpha = rho / dot(r0, v);
+    axpy(t, alpha, y);
+    s = r;
+    axpy(s, -alpha, v);
+    resid = std::sqrt(dot(s, s));
+    if (resid <= TOLERANCE * bnorm) {
+      break;
+    }
+    precondition(s, z);
+    multiply(z, w);
+    omega = dot(w, s) / dot(w, w);
+    axpy(t, omega, z);
+    r = s;
+    axpy(r, -omega, w);
+    resid = std::sqrt(dot(r, r));
+  }
+
+  std::cerr << "BiCGSTAB: " << iter << " iterations, relative residual ";
+  std::cerr << (bnorm > 0? resid / bnorm : 0.) << "\n";
+  if (resid > TOLERANCE * bnorm) {
+    std::cerr << "Warning: BiCGSTAB didn't converge\n";
+  }
+
+  for (size_t x = 0; x < n; ++x) {
+    if (!sure[x]) {
+      t[x] = INFINITY;
+    }
+  }
+  return t;
+}
+
+// Print the hitting time from every genotype, and their mean over the
+// uniform initial distribution of the experiments, both as steps to
+// absorption and as the engines' mean generation to an optimal solution:
+template <algorithm_t ALG>
+void
+run_hitting_times(const config_t& cfg, const fitness_table_t& table)
+{
+  const auto t = ALG == algorithm_t::SA? sa_hitting_times(table, cfg.len, cfg.temp)
+                                       : es_hitting_times(table, cfg.len);
+
+  std::cout << "# Genotype\tphenotype\tfitness\thitting_time\n";
+  for (size_t x = 0; x < t.size(); ++x) {
+    std::cout << x << "\t" << table.phenotype[x] << "\t" << table.fitness[x] << "\t" << t[x] << "\n";
+  }
+
+  const double mean = std::accumulate(t.cbegin(), t.cend(), 0.) / t.size();
+  std::cerr << "Expected steps to absorption from a random genotype: " << mean << "\n";
+  std::cerr << "Mean generation to optimal solution: " << mean + 1 << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void usage()
+{
+  std::cerr << "Usage: onemax [options] [a [p [g [e]]]]\n";
+  std::cerr << "Try running with the following integer arguments: a p g e\n";
+  std::cerr << "a:\tThe binary value to strive to (default: 31)\n";
+  std::cerr << "p:\tPopulation size, how many bitstrings are concatenated\n";
+  std::cerr << "g:\tNumber of generations (fitness evaluations) to run for\n";
+  std::cerr << "e:\tNumber of experiments to run concurrently\n";
+  std::cerr << "Options:\n";
+  std::cerr << "-A alg:\tAlgorithm: sa or es (default: es)\n";
+  std::cerr << "-r rep:\tRepresentation: sb, brg, or an explicit mapping name (default: sb):\n\t";
+  for (const auto& m : explicit_mappings) {
+    std::cerr << " " << m.first;
+  }
+  std::cerr << "\n";
+  std::cerr << "-f fit:\tFitness function: onemax or ones (default: onemax)\n";
+  std::cerr << "-l len:\tNumber of bits per organism (default: 5)\n";
+  std::cerr << "-m mut:\tES mutation method: bitwise or geometric (default: bitwise); the\n";
+  std::cerr << "\tother engines sample the same mutations their own way, so only the\n";
+  std::cerr << "\tobject engine takes geometric\n";
+  std::cerr << "-E eng:\tEngine: object (one Sim per experiment), batch (vectorized\n";
+  std::cerr << "\tacross experiments, for up to 63 bits, and for SA, a maximum fitness\n";
+  std::cerr << "\tof up to 2^16), or bitslice (64 experiments per word, for up to 63\n";
+  std::cerr << "\tbits with ones, or onemax on sb or brg, and otherwise up to ";
+  std::cerr << BitSliceEngine<sliced_fitness_t::TABLE, algorithm_t::ES>::MAX_BITS << " bits;\n";
+  std::cerr << "\tfor SA, the same maximum fitness as batch),\n";
+  std::cerr << "\tor exact (propagate the exact genotype distribution instead of\n";
+  std::cerr << "\tsampling, for up to " << ExactEngine<algorithm_t::ES>::MAX_BITS;
+  std::cerr << " bits; but ES with a fitness of many\n";
+  std::cerr << "\tlevels, like onemax, takes time quadratic in 2^len, seconds per\n";
+  std::cerr << "\tgeneration from about 16 bits) (default: object)\n";
+  std::cerr << "-t:\tTabulate the fitness of all genotypes before running (up to ";
+  std::cerr << fitness_table_t::MAX_BITS << " bits)\n";
+  std::cerr << "-s seed:\tMaster random seed (default: random, reported on stderr)\n";
+  std::cerr << "-T n:\tRun all generations of a tile of about n experiments before the\n";
+  std::cerr << "\tnext tile, rather than each generation of all experiments in turn\n";
+  std::cerr << "\t(default: 0, no tiling)\n";
+  std::cerr << "-S:\tES only: stop at the first generation where all experiments are\n";
+  std::cerr << "\tsolved, since none can change after that\n";
+  std::cerr << "-F file:\tWrite the distribution of the generation at which experiments\n";
+  std::cerr << "\tare first solved to file\n";
+  std::cerr << "-H:\tDon't run experiments, but solve for the expected steps to an optimal\n";
+  std::cerr << "\tsolution from every genotype, for one organism (SA at a fixed\n";
+  std::cerr << "\ttemperature, the initial one; up to " << fitness_table_t::MAX_BITS << " bits, but\n";
+  std::cerr << "\tES with a fitness of many levels, like onemax, takes time quadratic\n";
+  std::cerr << "\tin 2^len, minutes from about 18 bits)\n";
+  std::cerr << "-L lib:\tRun every explicit mapping in a library file in turn, rather than\n";
+  std::cerr << "\tthe representation of -r (see mapping_library_t for the format); their\n";
+  std::cerr << "\tlength is that of the library, so -l is optional\n";
+  std::cerr << "-P:\tCopy explicit mapping tables to huge pages, rather than use them in\n";
+  std::cerr << "\tplace\n";
+  std::cerr << "-I val:\tStart every organism at a genotype that encodes phenotype val\n";
+  std::cerr << "\t(the value for onemax, the number of ones for ones), rather than at a\n";
+  std::cerr << "\trandom genotype (for up to 63 bits)\n";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Tiled execution: run all the generations of a tile of experiments before
+// moving on to the next tile, so a tile's state stays in cache throughout,
+// and threads never wait for each other between generations. Each thread
+// adds the per-generation statistics of its tiles into its own array, and
+// the arrays are merged at the end. Entry g - 1 holds generation g's stats.
+template <class Engine>
+std::vector<gen_stats_t>
+run_tiled(const config_t& cfg, Engine& engine)
+{
+  const auto grain = std::max<size_t>(1, cfg.tile / engine.unit_size());
+  enumerable_thread_specific<std::vector<gen_stats_t>> local(
+      std::vector<gen_stats_t>(cfg.generations));
+
+  parallel_for(blocked_range<size_t>(0, engine.size(), grain),
+      [&](const blocked_range<size_t>& r) {
+        auto& stats = local.local();
+        for (unsigned g = 1; g <= cfg.generations; ++g) {
+          stats[g - 1] += engine.run_generation(r.begin(), r.end(), g);
+        }
+      }, simple_partitioner());
+
+  std::vector<gen_stats_t> ret(cfg.generations);
+  for (const auto& stats : local) {
+    for (size_t i = 0; i < ret.size(); ++i) {
+      ret[i] += stats[i];
+    }
+  }
+  return ret;
+}
+
+// The first-passage distribution: entry g is the fraction of experiments
+// first found solved at generation g, for g < generations (an experiment
+// that never was is recorded at generations).
+template <class Engine>
+std::vector<double>
+first_passage(const config_t& cfg, const Engine& engine)
+{
+  std::vector<double> ret(cfg.generations + 1);
+  for (const auto g : engine.solved_at()) {
+    ret[g] += 1. / cfg.experiments;
+  }
+  ret[cfg.generations] = 0;
+  return ret;
+}
+
+// With more than one organism, an experiment is solved when all of them are
+// at once, which the exact engine doesn't track, so there's no distribution:
+template <algorithm_t ALG>
+std::vector<double>
+first_passage(const config_t& cfg, const ExactEngine<ALG>& engine)
+{
+  if (cfg.popsize > 1) {
+    return {};
+  }
+  auto ret = engine.first_passage();
+  ret[cfg.generations] = 0;
+  return ret;
+}
+
+// Report the probability of solving an experiment within the run, and the
+// mean generation to an optimal solution of the experiments that are, and
+// write the whole first-passage distribution to cfg.fpt_file, if given. An
+// empty distribution is one the engine couldn't compute.
+void
+report_first_passage(const config_t& cfg, const std::vector<double>& fpt)
+{
+  if (fpt.empty()) {
+    std::cerr << "The exact engine doesn't compute the generation to an optimal solution ";
+    std::cerr << "for populations of more than one\n";
+    return;
+  }
+
+  double solved = 0, sum = 0;
+  for (unsigned g = 1; g < cfg.generations; ++g) {
+    solved += fpt[g];
+    sum += g * fpt[g];
+  }
+
+  std::cerr << "Mean generation to optimal solution: " << sum / solved << "\n";
+  std::cerr << "Probability of an optimal solution within the run: " << solved << std::endl;
+
+  if (!cfg.fpt_file.empty()) {
+    std::ofstream out(cfg.fpt_file);
+    out << "# Generation\tfirst_solved\tsolved_by\n";
+    double by = 0;
+    for (unsigned g = 1; g < cfg.generations; ++g) {
+      by += fpt[g];
+      out << g << "\t" << fpt[g] << "\t" << by << "\n";
+    }
+    if (!out) {
+      std::cerr << "Can't write " << cfg.fpt_file << "\n";
+      exit(1);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Simulation main loop, for a given engine.
+// Algorithm: Loop over number of generations. In each generation, mutate
+// each organism (there are 'experiments' of them), and decide whether to use
+// the mutated offspring instead of the parent organism for the next gen.
+// The decisions on how to mutate and when to replace a parent are based on
+// the specific GEA chosen (SA / ES).
+// Results are saved per generation, aggregated over all experiments, and
+// reported on a generation-by-generation basis.
+//
+template <class Engine>
+void
+run_engine(const config_t& cfg, Engine& engine)
+{
+  const auto popsize = cfg.popsize;
+  const auto generations = cfg.generations;
+  const auto experiments = cfg.experiments;
+
+  std::cout << "# Generation\tratio_optimal\tmean_fitness";
+  std::cout << "\tvar_fitness\tci95_fitness\tmin_fitness\tmax_fitness\n";
+
+  // ES experiments whose organisms are all optimal never change again:
+  const auto absorbed = [&](const gen_stats_t& stats) {
+    return cfg.stop && cfg.algorithm == algorithm_t::ES && stats.optimal == stats.count;
+  };
+
+  const auto report = [&](unsigned g, const gen_stats_t& stats) {
+    assert(stats.count == uint64_t(experiments) * popsize);
+    std::cout << g << "\t";
+    std::cout << double(stats.optimal) / stats.count << "\t";
+    std::cout << stats.mean() << "\t";
+    std::cout << stats.variance() << "\t";
+    std::cout << stats.ci95() << "\t";
+    std::cout << stats.min << "\t";
+    std::cout << stats.max << "\n";
+  };
+
+  if (cfg.tile) {
+    const auto stats = run_tiled(cfg, engine);
+    for (unsigned g = 1; g <= generations; ++g) {
+      report(g, stats[g - 1]);
+      if (absorbed(stats[g - 1])) {
+        break;
+      }
+    }
+  } else {
+    // Main loop: generations (the engine loops over experiments)
+    for (unsigned g = 1; g <= generations; ++g) {
+      const auto stats = engine.generation(g);
+      report(g, stats);
+      if (absorbed(stats)) {
+        break;
+      }
+    }
+  }
+
+  report_first_passage(cfg, first_passage(cfg, engine));
+}
+
+template <class Fitness, algorithm_t ALG>
+void
+run(const config_t& cfg, const Fitness& fit)
+{
+  if (cfg.hitting) {
+    if (cfg.len > fitness_table_t::MAX_BITS) {
+      std::cerr << "Hitting times are limited to " << fitness_table_t::MAX_BITS << " bits\n";
+      exit(1);
+    }
+    run_hitting_times<ALG>(cfg, make_fitness_table(fit, cfg.len));
+  } else if (cfg.engine == "object") {
+    SimEngine<Fitness, ALG> engine(cfg, fit);
+    run_engine(cfg, engine);
+  } else if (cfg.engine == "batch") {
+    using engine_t = BatchEngine<Fitness, ALG>;
+    if (cfg.len >= bits_t::WORD_BITS) {
+      std::cerr << "The batch engine needs genotypes shorter than 64 bits\n";
+      exit(1);
+    }
+    if (ALG == algorithm_t::SA && fit.optimum(cfg.len) > engine_t::MAX_OPTIMUM) {
+      std::cerr << "SA on the batch engine needs a maximum fitness of up to ";
+      std::cerr << engine_t::MAX_OPTIMUM << "\n";
+      exit(1);
+    }
+    engine_t engine(cfg, fit);
+    run_engine(cfg, engine);
+  } else if (cfg.engine == "bitslice") {
+    using engine_t = BitSliceEngine<sliced_fitness<Fitness>, ALG>;
+    if (cfg.len > engine_t::MAX_BITS) {
+      std::cerr << "The bitslice engine is limited to " << engine_t::MAX_BITS;
+      std::cerr << " bits for this representation and fitness function\n";
+      exit(1);
+    }
+    if (ALG == algorithm_t::SA && fit.optimum(cfg.len) > engine_t::MAX_OPTIMUM) {
+      std::cerr << "SA on the bitslice engine needs a maximum fitness of up to ";
+      std::cerr << engine_t::MAX_OPTIMUM << "\n";
+      exit(1);
+    }
+    // Only the multiplexer trees need a fitness table:
+    std::unique_ptr<fitness_table_t> table;
+    if (sliced_fitness<Fitness> == sliced_fitness_t::TABLE) {
+      table = std::make_unique<fitness_table_t>(make_fitness_table(fit, cfg.len));
+    }
+    if (!engine_t::integral(cfg, table.get())) {
+      std::cerr << "The bitslice engine needs nonnegative integral fitness values\n";
+      exit(1);
+    }
+    engine_t engine(cfg, fit, table.get());
+    run_engine(cfg, engine);
+  } else if (cfg.engine == "exact") {
+    using engine_t = ExactEngine<ALG>;
+    if (cfg.len > engine_t::MAX_BITS) {
+      std::cerr << "The exact engine is limited to " << engine_t::MAX_BITS << " bits\n";
+      exit(1);
+    }
+    if (cfg.popsize > 1 && !cfg.fpt_file.empty()) {
+      std::cerr << "The exact engine can't write the first-passage distribution (-F) ";
+      std::cerr << "for populations of more than one\n";
+      exit(1);
+    }
+    const auto table = make_fitness_table(fit, cfg.len);
+    engine_t engine(cfg, table);
+    run_engine(cfg, engine);
+  } else {
+    std::cerr << "Unknown engine: " << cfg.engine << "\n";
+    exit(1);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Runtime dispatch: pick the template instantiation of run() that matches
+// the configuration. Each level resolves one policy and passes it down.
+
+template <class Fitness>
+void
+dispatch_algorithm(const config_t& cfg, const Fitness& fit)
+{
+  switch (cfg.algorithm) {
+    case algorithm_t::SA: run<Fitness, algorithm_t::SA>(cfg, fit); break;
+    case algorithm_t::ES: run<Fitness, algorithm_t::ES>(cfg, fit); break;
+  }
+}
+
+// Replace the fitness function with a table of its values, if requested:
+template <class Fitness>
+void
+dispatch_table(const config_t& cfg, const Fitness& fit)
+{
+  if (!cfg.table) {
+    dispatch_algorithm(cfg, fit);
+    return;
+  }
+  if (cfg.len > fitness_table_t::MAX_BITS) {
+    std::cerr << "Fitness tables are limited to " << fitness_table_t::MAX_BITS << " bits\n";
+    exit(1);
+  }
+  const auto table = make_fitness_table(fit, cfg.len);
+  dispatch_algorithm(cfg, TabulatedFitness{ &table });
+}
+
+template <class Rep>
+void
+dispatch_fitness(const config_t& cfg, const Rep& rep)
+{
+  if (cfg.fitness == "onemax") {
+    if (cfg.len >= bits_t::WORD_BITS || cfg.a >= (phenotype_t(1) << cfg.len)) {
+      std::cerr << "onemax needs fewer than 64 bits and a < 2^len\n";
+      exit(1);
+    }
+    dispatch_table(cfg, OneMax<Rep>{ cfg.a, rep });
+  } else if (cfg.fitness == "ones") {
+    dispatch_table(cfg, CountOnes<Rep>{ cfg.a, rep });
+  } else {
+    std::cerr << "Unknown fitness function: " << cfg.fitness << "\n";
+    exit(1);
+  }
+}
+
+void
+dispatch(const config_t& cfg)
+{
+  if (cfg.rep == "sb") {
+    dispatch_fitness(cfg, StdBinaryRep{});
+  } else if (cfg.rep == "brg") {
+    dispatch_fitness(cfg, BrgRep{});
+  } else if (explicit_mappings.count(cfg.rep)) {
+    const auto mapping = explicit_mappings.at(cfg.rep);
+    if (mapping->size() != (size_t(1) << cfg.len)) {
+      std::cerr << "Mapping " << cfg.rep << " doesn't have 2^" << cfg.len << " entries\n";
+      exit(1);
+    }
+    const explicit_table_t table(mapping->data(), cfg.len, cfg.huge_pages);
+    dispatch_fitness(cfg, ExplicitRep{ &table });
+  } else {
+    std::cerr << "Unknown representation: " << cfg.rep << "\n";
+    exit(1);
+  }
+}
+
+// Run every mapping of a library in turn, each reported as a run of its own,
+// in a block of the output that starts with a comment naming the mapping
+// (blocks are separated by two blank lines, as gnuplot's index expects).
+// The first-passage distribution of mapping i, if requested, goes to
+// cfg.fpt_file.i. Mappings are run one after the other, each parallel
+// over its experiments, so they all share the same worker threads. Binary
+// mappings are used in place from the library's mapping, unless they're
+// copied to huge pages. Unless the library is checked(), each mapping is
+// read in full just before it runs, to check its values; a run on a wide
+// table touches most of its pages anyway, so this mostly reads them in
+// sooner, and in order.
+void
+run_library(const config_t& cfg, const mapping_library_t& library)
+{
+  for (size_t i = 0; i < library.size(); ++i) {
+    const auto view = library.mapping(i);
+    std::unique_ptr<explicit_table_t> copy;
+    if (cfg.huge_pages) {
+      copy = std::make_unique<explicit_table_t>(view, true);
+    }
+    const auto& mapping = copy? *copy : view;
+    if (!library.checked() && mapping.max() >> cfg.len) {
+      std::cerr << "Mapping " << library.name(i) << " has values of more than " << cfg.len << " bits\n";
+      exit(1);
+    }
+    auto mapping_cfg = cfg;
+    if (!cfg.fpt_file.empty()) {
+      mapping_cfg.fpt_file += "." + std::to_string(i);
+    }
+    std::cout << "# Mapping " << i << ": " << library.name(i) << "\n";
+    std::cerr << "Mapping " << i << ": " << library.name(i) << "\n";
+    dispatch_fitness(mapping_cfg, ExplicitRep{ &mapping });
+    std::cout << "\n\n";
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// First, simulation parameters are chosen, including which representation
+// to interpret the bit-string with, then the simulation is dispatched.
+int main(int argc, char* argv[])
+{
+  config_t cfg;
+
+  if (argc == 1) {
+    usage();
+  }
+
+  int opt;
+  bool len_given = false;
+  while ((opt = getopt(argc, argv, "A:r:f:l:m:E:ts:T:SF:HL:PI:")) != -1) {
+    switch (opt) {
+      case 'A':
+        if (std::string(optarg) == "sa") {
+          cfg.algorithm = algorithm_t::SA;
+        } else if (std::string(optarg) == "es") {
+          cfg.algorithm = algorithm_t::ES;
+        } else {
+          usage();
+          return 1;
+        }
+        break;
+      case 'r': cfg.rep = optarg; break;
+      case 'f': cfg.fitness = optarg; break;
+      case 'l': cfg.len = atoi(optarg); len_given = true; break;
+      case 'm':
+        if (std::string(optarg) == "bitwise") {
+          cfg.mutation = mutation_t::BITWISE;
+        } else if (std::string(optarg) == "geometric") {
+          cfg.mutation = mutation_t::GEOMETRIC;
+        } else {
+          usage();
+          return 1;
+        }
+        break;
+      case 'E': cfg.engine = optarg; break;
+      case 't': cfg.table = true; break;
+      case 's': cfg.seed = strtoull(optarg, nullptr, 0); break;
+      case 'T': cfg.tile = strtoull(optarg, nullptr, 0); break;
+      case 'S': cfg.stop = true; break;
+      case 'F': cfg.fpt_file = optarg; break;
+      case 'H': cfg.hitting = true; break;
+      case 'L': cfg.library = optarg; break;
+      case 'P': cfg.huge_pages = true; break;
+      case 'I': cfg.start = strtoll(optarg, nullptr, 0); break;
+      default: usage(); return 1;
+    }
+  }
+
+  // A library's mappings set the length, which -l can only repeat:
+  std::unique_ptr<mapping_library_t> library;
+  if (!cfg.library.empty()) {
+    library = std::make_unique<mapping_library_t>(cfg.library);
+    if (len_given && cfg.len != library->len()) {
+      std::cerr << "The mappings of " << cfg.library << " are of " << library->len();
+      std::cerr << " bits, not " << cfg.len << "\n";
+      return 1;
+    }
+    cfg.len = library->len();
+  }
+
+  if (cfg.len == 0) {
+    usage();
+    return 1;
+  }
+  if (cfg.stop && cfg.algorithm != algorithm_t::ES) {
+    std::cerr << "Only ES can stop once all experiments are solved (-S)\n";
+    return 1;
+  }
+  if (cfg.mutation == mutation_t::GEOMETRIC
+      && (cfg.algorithm != algorithm_t::ES || cfg.engine != "object" || cfg.hitting)) {
+    std::cerr << "Geometric mutation (-m) is for ES on the object engine only\n";
+    return 1;
+  }
+  if (cfg.start >= 0 && cfg.len >= bits_t::WORD_BITS) {
+    std::cerr << "Starting at a phenotype (-I) needs genotypes shorter than 64 bits\n";
+    return 1;
+  }
+  if (cfg.len < bits_t::WORD_BITS) {
+    cfg.a = (phenotype_t(1) << cfg.len) - 1;
+  }
+
+  const auto nargs = argc - optind;
+  const auto args = argv + optind;
+  if (nargs > 0) {
+    cfg.a = atoi(args[0]);
+  }
+  if (nargs > 1) {
+    cfg.popsize = atoi(args[1]);
+  }
+  if (nargs > 2) {
+    cfg.generations = atoi(args[2]);
+  }
+  if (nargs > 3) {
+    cfg.experiments = atoi(args[3]);
+  }
+
+  std::cerr << "Random seed: " << cfg.seed << "\n";
+  if (!library) {
+    dispatch(cfg);
+  } else {
+    run_library(cfg, *library);
+  }
   return 0;
 }